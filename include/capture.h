@@ -0,0 +1,309 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <WiFiClient.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+
+#include "capture_format.h"
+
+// Binary capture of the raw vMix TCP API stream.
+//
+// Records are appended to a RAM buffer and flushed to flash about once a
+// second. Storage is a two-segment ring: when /capture.0 is full it is
+// renamed to /capture.1 (dropping the old one) and a new /capture.0 starts,
+// so at most 2 * SEGMENT_BYTES of the most recent traffic is kept.
+//
+// Every line received is recorded, repeats and probe replies included, so
+// a replay feeds the parser exactly what it saw. With a backup configured
+// the fast VERSION probes alone add about 0.9 KB/s per probed link, which
+// leaves roughly ten minutes of history in the ring.
+//
+// Each segment starts with the file header of capture_format.h. Segments
+// survive firmware updates, so begin() deletes any whose header is not
+// the current version instead of serving old records under a new header.
+//
+// The download (see readDownload()) is a file header followed by the
+// records of both segments, in the layout of capture_format.h. A SESSION
+// marker is written whenever recording starts (at boot or when enabled over
+// HTTP); millis restarts with every boot, so a reader must restart its
+// timebase at each marker. The marker payload says why it started.
+// Lines are stored without their trailing CR/LF.
+// tools/vmix_replay.py and test/test_vmix_replay read this format.
+class CaptureLog {
+  static const uint32_t SEGMENT_BYTES = 256 * 1024;
+  static const unsigned long FLUSH_INTERVAL_MS = 1000;
+
+  fs::FS* fs = nullptr;
+  bool enabled = false;
+  CaptureBuffer pending;
+  uint32_t segment_used = 0;
+  unsigned long last_flush = 0;
+
+  // download snapshot, see beginDownload()
+  bool downloading = false;
+  size_t download_sizes[2] = {};
+  File download_file;
+  int download_segment = -1;
+
+  void rotate() {
+    fs->remove(PREVIOUS);
+    fs->rename(CURRENT, PREVIOUS);
+    segment_used = 0;
+  }
+
+  size_t fileSize(const char* path) {
+    if (!fs->exists(path)) {
+      return 0;
+    }
+    File f = fs->open(path, FILE_READ);
+    size_t size = f ? f.size() : 0;
+    f.close();
+    return size;
+  }
+
+  // Records in a segment, without its header.
+  size_t bodySize(const char* path) {
+    size_t size = fileSize(path);
+    return size > CaptureRecord::FILE_HEADER ? size - CaptureRecord::FILE_HEADER : 0;
+  }
+
+  bool isCurrentVersion(const char* path) {
+    uint8_t header[CaptureRecord::FILE_HEADER];
+    File f = fs->open(path, FILE_READ);
+    size_t n = f ? f.read(header, sizeof(header)) : 0;
+    f.close();
+    return CaptureRecord::isFileHeader(header, n);
+  }
+
+public:
+  static constexpr const char* CURRENT = "/capture.0";
+  static constexpr const char* PREVIOUS = "/capture.1";
+
+  uint32_t records = 0;
+  uint32_t dropped = 0;
+
+  bool begin(fs::FS& filesystem) {
+    fs = &filesystem;
+    const char* segments[] = {PREVIOUS, CURRENT};
+    for (auto path : segments) {
+      if (fs->exists(path) && !isCurrentVersion(path)) {
+        fs->remove(path);
+      }
+    }
+    segment_used = fileSize(CURRENT);
+    return true;
+  }
+
+  bool ready() const { return fs != nullptr; }
+  bool isEnabled() const { return enabled; }
+
+  // Turning recording on writes a SESSION marker with note as its payload.
+  void setEnabled(bool on, const char* note) {
+    if (!on) {
+      flush();
+    }
+    bool was = enabled;
+    enabled = on && fs != nullptr;
+    if (enabled && !was) {
+      record(millis(), CaptureRecord::SESSION, note, strlen(note));
+    }
+  }
+
+  // Append one raw line. Cheap: only copies into the RAM buffer unless it is
+  // full, in which case the buffer is written out first.
+  void record(uint32_t ms, uint8_t source, const char* line, size_t len) {
+    if (!enabled) {
+      return;
+    }
+    if (!pending.add(ms, source, line, len, [this]() { flush(); })) {
+      dropped++;
+      return;
+    }
+    records++;
+  }
+
+  // Call from the main loop; writes the buffer out at most once per interval.
+  void poll(unsigned long now) {
+    if (pending.len > 0 && now - last_flush >= FLUSH_INTERVAL_MS) {
+      flush();
+    }
+  }
+
+  void flush() {
+    last_flush = millis();
+    if (pending.len == 0 || fs == nullptr) {
+      return;
+    }
+    // a running download reads both segments; rotate once it is done
+    if (segment_used + pending.len > SEGMENT_BYTES && !downloading) {
+      rotate();
+    }
+    File f = fs->open(CURRENT, FILE_APPEND);
+    if (!f) {
+      dropped += pending.records;
+      pending.clear();
+      return;
+    }
+    if (segment_used == 0) {
+      uint8_t header[CaptureRecord::FILE_HEADER];
+      CaptureRecord::fileHeader(header);
+      f.write(header, sizeof(header));
+      segment_used = sizeof(header);
+    }
+    f.write(pending.data, pending.len);
+    f.close();
+    segment_used += pending.len;
+    pending.clear();
+  }
+
+  void clear() {
+    pending.clear();
+    fs->remove(CURRENT);
+    fs->remove(PREVIOUS);
+    segment_used = 0;
+    records = 0;
+    dropped = 0;
+  }
+
+  // Snapshot both segments for a download and return its size, header
+  // included. Until endDownload(), rotation is held back and records
+  // appended after the snapshot are not part of the download.
+  size_t beginDownload() {
+    flush();
+    downloading = true;
+    download_sizes[0] = bodySize(PREVIOUS);
+    download_sizes[1] = bodySize(CURRENT);
+    download_segment = -1;
+    return CaptureRecord::FILE_HEADER + download_sizes[0] + download_sizes[1];
+  }
+
+  void endDownload() {
+    download_file.close();
+    download_segment = -1;
+    downloading = false;
+  }
+
+  // Copy up to len bytes of the download, oldest segment first, starting
+  // at offset. Returns the number of bytes copied, 0 at the end or on error.
+  size_t readDownload(size_t offset, uint8_t* dst, size_t len) {
+    if (offset < CaptureRecord::FILE_HEADER) {
+      uint8_t header[CaptureRecord::FILE_HEADER];
+      CaptureRecord::fileHeader(header);
+      size_t n = CaptureRecord::FILE_HEADER - offset < len ? CaptureRecord::FILE_HEADER - offset : len;
+      memcpy(dst, header + offset, n);
+      return n;
+    }
+    offset -= CaptureRecord::FILE_HEADER;
+    int segment = 0;
+    if (offset >= download_sizes[0]) {
+      offset -= download_sizes[0];
+      segment = 1;
+    }
+    if (offset >= download_sizes[segment]) {
+      return 0;
+    }
+    if (segment != download_segment) {
+      download_file.close();
+      download_file = fs->open(segment ? CURRENT : PREVIOUS, FILE_READ);
+      download_segment = segment;
+    }
+    // skip the segment's own header
+    size_t pos = offset + CaptureRecord::FILE_HEADER;
+    if (!download_file || (download_file.position() != pos && !download_file.seek(pos))) {
+      return 0;
+    }
+    size_t left = download_sizes[segment] - offset;
+    return download_file.read(dst, len < left ? len : left);
+  }
+};
+
+// Sends a GET /capture body from the main loop, a slice per call, so a
+// download never holds up tally. The HTTP handler writes the headers and
+// hands the client over with start(); poll() then writes with MSG_DONTWAIT
+// and stops when the socket buffer is full, resuming on the next frame.
+class CaptureDownload {
+public:
+  static const size_t BYTES_PER_POLL = 4096;
+  static const unsigned long STALL_TIMEOUT_MS = 10000;
+
+  uint32_t completed = 0;
+  uint32_t aborted = 0;
+
+  bool active() const { return running; }
+
+  void start(CaptureLog& log, WiFiClient c, size_t size, unsigned long now) {
+    client = c;
+    total = size;
+    offset = 0;
+    last_progress = now;
+    running = true;
+    source = &log;
+  }
+
+  void poll(unsigned long now) {
+    if (!running) {
+      return;
+    }
+    size_t budget = BYTES_PER_POLL;
+    while (budget > 0 && offset < total) {
+      int fd = client.fd();
+      if (fd < 0 || !client.connected()) {
+        finish(false);
+        return;
+      }
+      size_t want = total - offset;
+      if (want > sizeof(chunk)) {
+        want = sizeof(chunk);
+      }
+      if (want > budget) {
+        want = budget;
+      }
+      size_t n = source->readDownload(offset, chunk, want);
+      if (n == 0) {
+        finish(false);
+        return;
+      }
+      int sent = send(fd, chunk, n, MSG_DONTWAIT);
+      if (sent < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          finish(false);
+          return;
+        }
+        break;
+      }
+      offset += sent;
+      budget -= (size_t)sent < budget ? sent : budget;
+      last_progress = now;
+      if ((size_t)sent < n) {
+        break;
+      }
+    }
+    if (offset >= total) {
+      finish(true);
+    } else if (now - last_progress > STALL_TIMEOUT_MS) {
+      finish(false);
+    }
+  }
+
+private:
+  CaptureLog* source = nullptr;
+  WiFiClient client;
+  uint8_t chunk[1460];
+  size_t total = 0;
+  size_t offset = 0;
+  unsigned long last_progress = 0;
+  bool running = false;
+
+  void finish(bool ok) {
+    client.stop();
+    source->endDownload();
+    running = false;
+    if (ok) {
+      completed++;
+    } else {
+      aborted++;
+    }
+  }
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Byte layout of the vMix capture, shared by CaptureLog (capture.h), the
+// native tests and, by hand, tools/vmix_replay.py.
+//
+//   file:   "VMXCAP" u8 version u8 reserved, then records
+//   record: u32 millis (LE) | u16 length (LE) | u8 source | length bytes
+//
+// source is the vMix link (0 primary, 1 secondary) or SESSION for the
+// marker written when recording starts; millis restarts at every boot.
+// A link's source has TRUNCATED set for a line longer than VMIX_MAX_LINE,
+// which the surface discarded; only its first VMIX_MAX_LINE bytes are kept.
+struct CaptureRecord {
+  static const uint8_t VERSION = 4;
+  static const uint8_t SESSION = 0xFF;
+  static const uint8_t TRUNCATED = 0x80;
+  static const size_t FILE_HEADER = 8;
+  static const size_t HEADER = 7;
+
+  uint32_t ms = 0;
+  uint8_t source = 0;
+  const uint8_t* data = nullptr;
+  size_t len = 0;
+
+  static void fileHeader(uint8_t* dst) {
+    static const uint8_t header[FILE_HEADER] = {'V', 'M', 'X', 'C', 'A', 'P', VERSION, 0};
+    memcpy(dst, header, FILE_HEADER);
+  }
+
+  // source of a line record from link, flagged when the line was discarded
+  static uint8_t lineSource(uint8_t link, bool complete) {
+    return complete ? link : link | TRUNCATED;
+  }
+
+  static bool isFileHeader(const uint8_t* p, size_t len) {
+    return len >= FILE_HEADER && memcmp(p, "VMXCAP", 6) == 0 && p[6] == VERSION;
+  }
+
+  // Write one record to dst, which must hold HEADER + len bytes.
+  static size_t encode(uint8_t* dst, uint32_t ms, uint8_t source, const char* line, size_t len) {
+    dst[0] = ms & 0xFF;
+    dst[1] = (ms >> 8) & 0xFF;
+    dst[2] = (ms >> 16) & 0xFF;
+    dst[3] = (ms >> 24) & 0xFF;
+    dst[4] = len & 0xFF;
+    dst[5] = (len >> 8) & 0xFF;
+    dst[6] = source;
+    memcpy(dst + HEADER, line, len);
+    return HEADER + len;
+  }
+
+  // Read the record at p. Returns the bytes it takes, or 0 if fewer than
+  // that are left (a capture cut off mid-record).
+  size_t decode(const uint8_t* p, size_t left) {
+    if (left < HEADER) {
+      return 0;
+    }
+    size_t n = p[4] | (p[5] << 8);
+    if (left < HEADER + n) {
+      return 0;
+    }
+    ms = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    source = p[6];
+    data = p + HEADER;
+    len = n;
+    return HEADER + n;
+  }
+};
+
+// RAM staging of records before they are written out, shared by CaptureLog
+// and the native tests so both run the same append path.
+class CaptureBuffer {
+public:
+  static const size_t SIZE = 2048;
+
+  uint8_t data[SIZE];
+  size_t len = 0;
+  uint32_t records = 0;
+
+  // Append one record. When it does not fit behind what is buffered,
+  // write_out() is called first and must write data out and clear().
+  // Returns false for a record that can never fit.
+  template <typename F>
+  bool add(uint32_t ms, uint8_t source, const char* line, size_t n, F write_out) {
+    if (CaptureRecord::HEADER + n > SIZE) {
+      return false;
+    }
+    if (len + CaptureRecord::HEADER + n > SIZE) {
+      write_out();
+      if (len + CaptureRecord::HEADER + n > SIZE) {
+        return false;
+      }
+    }
+    len += CaptureRecord::encode(data + len, ms, source, line, n);
+    records++;
+    return true;
+  }
+
+  void clear() {
+    len = 0;
+    records = 0;
+  }
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <WiFiClient.h>
+#include <lwip/sockets.h>
+#include <stdio.h>
+
+// Server-sent events for GET /events.
+//
+// The HTTP handler hands its client over with accept(); the socket is then
+// kept here after WebServer lets go of it. Sends never block the loop: each
+// frame goes out with one MSG_DONTWAIT send, and a client whose socket
+// buffer cannot take the whole frame is dropped instead of waited on.
+// At most MAX_CLIENTS are served; accept() refuses the rest.
+//
+// There is no keepalive: Engine publishes the status every second, which
+// keeps an idle stream busier than any proxy timeout.
+class EventStream {
+public:
+  static const size_t MAX_CLIENTS = 3;
+
+  enum Result {
+    ACCEPTED, // headers sent, the client gets every event from now on
+    REFUSED,  // all slots taken; the socket is untouched, answer it
+    FAILED,   // the client went away before the headers were sent
+  };
+
+  uint32_t sent = 0;
+  uint32_t closed = 0;  // client went away
+  uint32_t dropped = 0; // client too slow to take a frame
+  uint32_t refused = 0; // over MAX_CLIENTS
+
+  size_t clientCount() const {
+    size_t n = 0;
+    for (auto& c : clients) {
+      if (c.active) {
+        n++;
+      }
+    }
+    return n;
+  }
+
+  Result accept(WiFiClient client) {
+    for (auto& c : clients) {
+      if (c.active) {
+        continue;
+      }
+      static const char headers[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "\r\n"
+        "retry: 2000\n\n";
+      client.setNoDelay(true);
+      if (client.write((const uint8_t*)headers, sizeof(headers) - 1) != sizeof(headers) - 1) {
+        closed++;
+        return FAILED;
+      }
+      c.client = client;
+      c.active = true;
+      return ACCEPTED;
+    }
+    refused++;
+    return REFUSED;
+  }
+
+  // Send one event to every client. data must be a single line.
+  void publish(const char* event, const char* data, size_t len) {
+    int n = snprintf(frame, sizeof(frame), "event: %s\ndata: %.*s\n\n", event, (int)len, data);
+    if (n < 0 || (size_t)n >= sizeof(frame)) {
+      return;
+    }
+    sendAll(frame, n);
+  }
+
+private:
+  struct Slot {
+    WiFiClient client;
+    bool active = false;
+  };
+
+  Slot clients[MAX_CLIENTS];
+  char frame[1280];
+
+  void drop(Slot& c, uint32_t& counter) {
+    c.client.stop();
+    c.active = false;
+    counter++;
+  }
+
+  void sendAll(const char* buf, size_t len) {
+    for (auto& c : clients) {
+      if (!c.active) {
+        continue;
+      }
+      int fd = c.client.fd();
+      if (fd < 0 || !c.client.connected()) {
+        drop(c, closed);
+        continue;
+      }
+      int n = send(fd, buf, len, MSG_DONTWAIT);
+      if (n != (int)len) {
+        // a partial frame would corrupt the stream; the client reconnects
+        drop(c, dropped);
+        continue;
+      }
+      sent++;
+    }
+  }
+};
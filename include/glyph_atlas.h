@@ -0,0 +1,139 @@
+#pragma once
+
+#include <M5Unified.h>
+
+// Pre-rendered, anti-aliased glyphs for the large tally labels.
+//
+// tools/gen_glyph_atlas.py generates glyph_atlas_data.h at build time from
+// the FreeSansBold24pt7b bitmap in M5GFX: glyphs scaled by 2 and smoothed
+// with a 3x3 tent filter into GLYPH_ATLAS_LEVELS coverage levels. The
+// tables are const, so they stay in flash and nothing is built at boot.
+// Each glyph row is stored run-length encoded, one byte per run:
+//   (level << 6) | (run length - 1)
+// Drawing decodes a row into horizontal spans and fills each one with the
+// fg/bg blend for its level, skipping level 0 (background already drawn).
+//
+// The tally sprite is 8-bit (RGB332; a 16-bit full-screen sprite does not
+// fit the Core's heap), whose 2-bit blue channel holds 4 steps, so the
+// generator uses 4 levels: more would collapse onto the same colours.
+//
+// Only the generated charset is available; text with other characters
+// reports !canDraw() and the caller falls back to the regular font.
+struct GlyphAtlasGlyph {
+  char c;
+  uint16_t offset;
+  uint16_t size;
+  uint8_t width;
+  uint8_t height;
+  uint8_t advance;
+  int8_t xOffset;
+  int8_t yOffset;
+};
+
+#include "glyph_atlas_data.h"
+
+class GlyphAtlas {
+  uint16_t palette[GLYPH_ATLAS_LEVELS];
+
+  static const GlyphAtlasGlyph* find(char c) {
+    for (size_t i = 0; i < GLYPH_ATLAS_COUNT; i++) {
+      if (GLYPH_ATLAS_GLYPHS[i].c == c) {
+        return &GLYPH_ATLAS_GLYPHS[i];
+      }
+    }
+    return nullptr;
+  }
+
+  void setColors(uint16_t fg, uint16_t bg) {
+    int fr = (fg >> 11) & 0x1F, fgr = (fg >> 5) & 0x3F, fb = fg & 0x1F;
+    int br = (bg >> 11) & 0x1F, bgr = (bg >> 5) & 0x3F, bb = bg & 0x1F;
+    const int top = GLYPH_ATLAS_LEVELS - 1;
+    for (int i = 0; i < GLYPH_ATLAS_LEVELS; i++) {
+      int r = br + (fr - br) * i / top;
+      int g = bgr + (fgr - bgr) * i / top;
+      int b = bb + (fb - bb) * i / top;
+      palette[i] = (uint16_t)((r << 11) | (g << 5) | b);
+    }
+  }
+
+  void drawGlyph(M5Canvas& dst, const GlyphAtlasGlyph& g, int x, int y) {
+    const uint8_t* p = GLYPH_ATLAS_RLE + g.offset;
+    const uint8_t* end = p + g.size;
+    for (int row = 0; row < g.height && p < end; row++) {
+      int col = 0;
+      int span_start = 0;
+      int span_level = 0;
+      while (col < g.width && p < end) {
+        int level = *p >> 6;
+        int len = (*p & 0x3F) + 1;
+        p++;
+        if (level != span_level) {
+          if (span_level > 0) {
+            dst.drawFastHLine(x + span_start, y + row, col - span_start, palette[span_level]);
+          }
+          span_start = col;
+          span_level = level;
+        }
+        col += len;
+      }
+      if (span_level > 0) {
+        dst.drawFastHLine(x + span_start, y + row, col - span_start, palette[span_level]);
+      }
+    }
+  }
+
+public:
+  size_t size() const { return sizeof(GLYPH_ATLAS_RLE) + sizeof(GLYPH_ATLAS_GLYPHS); }
+
+  bool canDraw(const char* text) const {
+    for (; *text; text++) {
+      if (!find(*text)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int textWidth(const char* text) const {
+    int w = 0;
+    for (; *text; text++) {
+      const GlyphAtlasGlyph* g = find(*text);
+      if (g) {
+        w += g->advance;
+      }
+    }
+    return w;
+  }
+
+  // Distance from the baseline to the top of the tallest glyph in text.
+  int ascent(const char* text) const {
+    int a = 0;
+    for (; *text; text++) {
+      const GlyphAtlasGlyph* g = find(*text);
+      if (g && -g->yOffset > a) {
+        a = -g->yOffset;
+      }
+    }
+    return a;
+  }
+
+  // Draw text with its baseline at y. Returns the render time in microseconds.
+  uint32_t draw(M5Canvas& dst, const char* text, int x, int y, uint16_t fg, uint16_t bg) {
+    uint32_t start = micros();
+    setColors(fg, bg);
+    for (; *text; text++) {
+      const GlyphAtlasGlyph* g = find(*text);
+      if (!g) {
+        continue;
+      }
+      drawGlyph(dst, *g, x + g->xOffset, y + g->yOffset);
+      x += g->advance;
+    }
+    return micros() - start;
+  }
+
+  // Draw text centered on (cx, cy).
+  uint32_t drawCentered(M5Canvas& dst, const char* text, int cx, int cy, uint16_t fg, uint16_t bg) {
+    return draw(dst, text, cx - textWidth(text) / 2, cy + ascent(text) / 2, fg, bg);
+  }
+};
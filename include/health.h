@@ -0,0 +1,257 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Heartbeats, loop-time budgets and graded recovery for the Engine loop.
+//
+// The monitor only keeps state and decides; Engine performs the actions,
+// since it owns the vMix socket, WiFi and the servers.
+//
+// Only the vMix link has a heartbeat, stamped by lines arriving from vMix.
+// HTTP, DNS and rendering only do work when asked, so a quiet period there
+// is not a fault. They get loop-time budgets instead, and since they all
+// run in the Engine loop, a hang in any of them stops the loop from feeding
+// the task watchdog.
+//
+// vMix link recovery escalates while the link stays down or silent:
+//   RESUBSCRIBE -> RECONNECT (repeated) -> WIFI_RESTART -> REBOOT
+// WiFi is only restarted when it is down, and REBOOT is only chosen when
+// WiFi is still down after that restart. With WiFi up the monitor keeps
+// reconnecting, so a vMix that is simply not running does not put the
+// surface into a WiFi restart or reboot loop.
+class HealthMonitor {
+public:
+  enum Subsystem {
+    VMIX,
+    RENDER,
+    HTTP,
+    DNS,
+    SUBSYSTEM_COUNT,
+  };
+
+  enum Action {
+    NONE,
+    RESUBSCRIBE,
+    RECONNECT,
+    WIFI_RESTART,
+    REBOOT,
+    SERVER_RESTART,
+    ACTION_COUNT,
+  };
+
+  struct Stats {
+    unsigned long last_beat = 0;
+    uint32_t timeout_ms = 0; // 0: no heartbeat
+    uint32_t budget_us = 0;
+    uint32_t last_us = 0;
+    uint32_t max_us = 0;
+    uint32_t overruns = 0;
+    uint32_t consecutive_overruns = 0;
+  };
+
+  static const uint32_t LOOP_BUDGET_US = 50000;
+  // vMix only talks on change, so Engine sends a VERSION probe this often
+  static const unsigned long PROBE_INTERVAL_MS = 2000;
+  // consecutive HTTP/DNS overruns before that server is restarted
+  static const uint32_t MAX_SERVER_OVERRUNS = 5;
+
+  Stats subsystems[SUBSYSTEM_COUNT];
+  uint32_t actions[ACTION_COUNT] = {};
+  uint32_t loop_last_us = 0;
+  uint32_t loop_max_us = 0;
+  // recent worst loop: follows spikes at once, halves in about 6 s at 60 fps
+  uint32_t loop_peak_us = 0;
+  uint32_t loop_overruns = 0;
+  // kept in Preferences by Engine, so they survive the restart they count
+  uint32_t reboots = 0;
+  uint32_t watchdog_resets = 0;
+
+  HealthMonitor() {
+    subsystems[VMIX].timeout_ms = 3 * PROBE_INTERVAL_MS;
+    subsystems[VMIX].budget_us = 5000;
+    subsystems[RENDER].budget_us = LOOP_BUDGET_US;
+    subsystems[HTTP].budget_us = 20000;
+    subsystems[DNS].budget_us = 5000;
+  }
+
+  void begin(unsigned long now) {
+    for (auto& s : subsystems) {
+      s.last_beat = now;
+    }
+    level = NONE;
+  }
+
+  void beat(Subsystem s, unsigned long now) {
+    subsystems[s].last_beat = now;
+  }
+
+  // Record how long one call into a subsystem took.
+  void timed(Subsystem s, uint32_t us) {
+    Stats& st = subsystems[s];
+    st.last_us = us;
+    if (us > st.max_us) {
+      st.max_us = us;
+    }
+    if (us > st.budget_us) {
+      st.overruns++;
+      st.consecutive_overruns++;
+    } else {
+      st.consecutive_overruns = 0;
+    }
+  }
+
+  void loopTime(uint32_t us) {
+    loop_last_us = us;
+    if (us > loop_max_us) {
+      loop_max_us = us;
+    }
+    loop_peak_us = us > loop_peak_us ? us : loop_peak_us - loop_peak_us / 512;
+    if (us > LOOP_BUDGET_US) {
+      loop_overruns++;
+    }
+  }
+
+  bool hasHeartbeat(Subsystem s) const {
+    return subsystems[s].timeout_ms > 0;
+  }
+
+  // A beat stamped after the caller read now counts as age 0.
+  unsigned long age(Subsystem s, unsigned long now) const {
+    unsigned long a = now - subsystems[s].last_beat;
+    return (long)a < 0 ? 0 : a;
+  }
+
+  bool isStale(Subsystem s, unsigned long now) const {
+    return hasHeartbeat(s) && age(s, now) > subsystems[s].timeout_ms;
+  }
+
+  // True once per streak of overruns on HTTP or DNS; counts the restart.
+  bool needsServerRestart(Subsystem s) {
+    Stats& st = subsystems[s];
+    if (st.consecutive_overruns < MAX_SERVER_OVERRUNS) {
+      return false;
+    }
+    st.consecutive_overruns = 0;
+    actions[SERVER_RESTART]++;
+    return true;
+  }
+
+  // Next recovery step for the vMix link, or NONE. The returned action is
+  // counted; the caller is expected to perform it right away.
+  Action nextAction(unsigned long now, bool link_up, bool wifi_up) {
+    if (link_up && !isStale(VMIX, now)) {
+      level = NONE;
+      return NONE;
+    }
+    if (level != NONE && now - level_since < grace(level)) {
+      return NONE;
+    }
+
+    Action next;
+    switch (level) {
+      case NONE:
+        next = link_up ? RESUBSCRIBE : RECONNECT;
+        break;
+      case RESUBSCRIBE:
+        next = RECONNECT;
+        break;
+      case RECONNECT:
+        next = wifi_up ? RECONNECT : WIFI_RESTART;
+        break;
+      case WIFI_RESTART:
+        next = wifi_up ? RECONNECT : REBOOT;
+        break;
+      default:
+        next = REBOOT;
+    }
+    level = next;
+    level_since = now;
+    actions[next]++;
+    return next;
+  }
+
+  Action currentLevel() const { return level; }
+
+  static const char* name(Subsystem s) {
+    switch (s) {
+      case VMIX: return "vmix";
+      case RENDER: return "render";
+      case HTTP: return "http";
+      case DNS: return "dns";
+      default: return "?";
+    }
+  }
+
+  static const char* name(Action a) {
+    switch (a) {
+      case NONE: return "none";
+      case RESUBSCRIBE: return "resubscribe";
+      case RECONNECT: return "reconnect";
+      case WIFI_RESTART: return "wifi_restart";
+      case REBOOT: return "reboot";
+      case SERVER_RESTART: return "server_restart";
+      default: return "?";
+    }
+  }
+
+  // Serialize into buf as a JSON object. Returns the length written,
+  // or 0 if buf was too small.
+  size_t toJson(char* buf, size_t len, unsigned long now) const {
+    size_t pos = 0;
+    int n = snprintf(buf, len, "{\"uptime_ms\":%lu,\"level\":\"%s\",\"subsystems\":{",
+      now, name(level));
+    if (n < 0 || (size_t)n >= len) {
+      return 0;
+    }
+    pos += n;
+    for (int i = 0; i < SUBSYSTEM_COUNT; i++) {
+      const Stats& st = subsystems[i];
+      char age_ms[12] = "null";
+      if (hasHeartbeat((Subsystem)i)) {
+        snprintf(age_ms, sizeof(age_ms), "%lu", age((Subsystem)i, now));
+      }
+      n = snprintf(buf + pos, len - pos,
+        "%s\"%s\":{\"age_ms\":%s,\"last_us\":%u,\"max_us\":%u,\"budget_us\":%u,\"overruns\":%u}",
+        i ? "," : "", name((Subsystem)i), age_ms,
+        (unsigned)st.last_us, (unsigned)st.max_us, (unsigned)st.budget_us, (unsigned)st.overruns);
+      if (n < 0 || (size_t)n >= len - pos) {
+        return 0;
+      }
+      pos += n;
+    }
+    n = snprintf(buf + pos, len - pos,
+      "},\"loop\":{\"last_us\":%u,\"max_us\":%u,\"peak_us\":%u,\"budget_us\":%u,\"overruns\":%u},\"actions\":{",
+      (unsigned)loop_last_us, (unsigned)loop_max_us, (unsigned)loop_peak_us, (unsigned)LOOP_BUDGET_US, (unsigned)loop_overruns);
+    if (n < 0 || (size_t)n >= len - pos) {
+      return 0;
+    }
+    pos += n;
+    for (int i = RESUBSCRIBE; i < ACTION_COUNT; i++) {
+      n = snprintf(buf + pos, len - pos, "%s\"%s\":%u",
+        i != RESUBSCRIBE ? "," : "", name((Action)i), (unsigned)actions[i]);
+      if (n < 0 || (size_t)n >= len - pos) {
+        return 0;
+      }
+      pos += n;
+    }
+    n = snprintf(buf + pos, len - pos, "},\"reboots\":%u,\"watchdog_resets\":%u}",
+      (unsigned)reboots, (unsigned)watchdog_resets);
+    if (n < 0 || (size_t)n >= len - pos) {
+      return 0;
+    }
+    return pos + n;
+  }
+
+private:
+  Action level = NONE;
+  unsigned long level_since = 0;
+
+  static unsigned long grace(Action a) {
+    switch (a) {
+      case RESUBSCRIBE: return 3000;
+      case RECONNECT: return 5000;
+      case WIFI_RESTART: return 20000;
+      default: return 5000;
+    }
+  }
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// vMix TCP API parsing: line assembly and the tally/ACTS state of one vMix.
+//
+// Nothing here depends on Arduino, so the native tests in test/ replay
+// captures through the same code the surface runs (pio test -e native).
+
+enum Tally {
+  SAFE,
+  PGM,
+  PRV,
+  UNKNOWN,
+};
+
+inline Tally parseTallyInt(char c) {
+  switch (c) {
+    case '0':
+      return Tally::SAFE;
+    case '1':
+      return Tally::PGM;
+    case '2':
+      return Tally::PRV;
+    default:
+      return Tally::UNKNOWN;
+  }
+}
+
+// vMix has at most 1000 inputs, and TALLY OK carries one char per input.
+static const size_t VMIX_MAX_INPUTS = 1000;
+
+// Longest line kept, without CR/LF: a TALLY OK for every input fits.
+static const size_t VMIX_MAX_LINE = 1023;
+
+// Splits the byte stream of one connection into lines without CR/LF.
+// A line that does not fit is discarded whole and counted in overlong,
+// never handed on cut short; for the capture, line() then holds its first
+// VMIX_MAX_LINE chars.
+class VmixLineReader {
+public:
+  enum Result {
+    PARTIAL,   // no complete line yet
+    LINE,      // line() holds a complete line until the next push()
+    DISCARDED, // a line ended, but it was too long to parse
+  };
+
+  uint32_t overlong = 0;
+
+  void reset() {
+    len = 0;
+    skipping = false;
+  }
+
+  Result push(char c) {
+    if (c == '\r') {
+      return PARTIAL;
+    }
+    if (c == '\n') {
+      buf[len] = '\0';
+      line_len = len;
+      len = 0;
+      if (skipping) {
+        skipping = false;
+        overlong++;
+        return DISCARDED;
+      }
+      return line_len > 0 ? LINE : PARTIAL;
+    }
+    if (len < VMIX_MAX_LINE) {
+      buf[len++] = c;
+    } else {
+      skipping = true;
+    }
+    return PARTIAL;
+  }
+
+  const char* line() const { return buf; }
+  size_t length() const { return line_len; }
+
+private:
+  char buf[VMIX_MAX_LINE + 1];
+  size_t len = 0;
+  size_t line_len = 0;
+  bool skipping = false;
+};
+
+// What one vMix has told us: the last TALLY OK payload and the input
+// reported by ACTS. handle() never allocates.
+class VmixState {
+public:
+  enum Kind {
+    TALLY,
+    ACTS,
+    VERSION, // reply to a VERSION probe
+    OTHER,
+  };
+
+  // last "TALLY OK" payload, one state char per input; any payload the
+  // line reader passes on fits whole
+  char tally_states[VMIX_MAX_LINE + 1] = "";
+  int current_input = 0;
+
+  // fields of the last ACTS line, for logging
+  char acts_event[32] = "";
+  int acts_input = 0;
+  int acts_target = 0;
+
+  void reset() {
+    tally_states[0] = '\0';
+    current_input = 0;
+  }
+
+  // Parse one line without CR/LF. changed is set when the line changed
+  // tally_states or current_input.
+  Kind handle(const char* data, size_t len, bool& changed) {
+    static const char TALLY_OK[] = "TALLY OK ";
+    static const char ACTS_OK[] = "ACTS OK ";
+    static const char VERSION_OK[] = "VERSION OK";
+    changed = false;
+    if (len >= sizeof(TALLY_OK) - 1 && strncmp(data, TALLY_OK, sizeof(TALLY_OK) - 1) == 0) {
+      const char* states = data + sizeof(TALLY_OK) - 1;
+      if (strncmp(tally_states, states, sizeof(tally_states) - 1) != 0) {
+        strncpy(tally_states, states, sizeof(tally_states) - 1);
+        tally_states[sizeof(tally_states) - 1] = '\0';
+        changed = true;
+      }
+      return TALLY;
+    }
+    if (len >= sizeof(VERSION_OK) - 1 && strncmp(data, VERSION_OK, sizeof(VERSION_OK) - 1) == 0) {
+      return VERSION;
+    }
+
+    if (len < sizeof(ACTS_OK) - 1 || strncmp(data, ACTS_OK, sizeof(ACTS_OK) - 1) != 0) {
+      return OTHER;
+    }
+    // ACTS OK <event> <input> <target>, input is sometimes a float
+    const char* event = data + sizeof(ACTS_OK) - 1;
+    const char* space = strchr(event, ' ');
+    size_t event_len = space ? (size_t)(space - event) : strlen(event);
+    size_t copy = event_len < sizeof(acts_event) - 1 ? event_len : sizeof(acts_event) - 1;
+    memcpy(acts_event, event, copy);
+    acts_event[copy] = '\0';
+
+    const char* rest = space ? space + 1 : event + event_len;
+    acts_input = (int)strtol(rest, nullptr, 10);
+    space = strchr(rest, ' ');
+    acts_target = space ? atoi(space + 1) : 0;
+
+    if (event_len == 5 && strncmp(event, "Input", event_len) == 0 && acts_target == 1) {
+      changed = current_input != acts_input;
+      current_input = acts_input;
+    }
+    return ACTS;
+  }
+
+  // Tally of input target (1-based).
+  Tally tally(int target) const {
+    if (target < 1 || (size_t)target > strlen(tally_states)) {
+      return Tally::UNKNOWN;
+    }
+    return parseTallyInt(tally_states[target - 1]);
+  }
+};
+
+// The receive path of one vMix link, shared by VmixLink and the native
+// tests: bytes in, every line that ends to record(line, len, complete),
+// and complete lines parsed and handed to
+// handled(kind, changed, line, len). complete is false for a discarded
+// overlong line, of which only the start is passed.
+class VmixReceiver {
+public:
+  VmixLineReader rx;
+  VmixState state;
+
+  template <typename Record, typename Handled>
+  VmixLineReader::Result push(char c, Record record, Handled handled) {
+    auto result = rx.push(c);
+    if (result == VmixLineReader::PARTIAL) {
+      return result;
+    }
+    bool complete = result == VmixLineReader::LINE;
+    record(rx.line(), rx.length(), complete);
+    if (complete) {
+      bool changed;
+      auto kind = state.handle(rx.line(), rx.length(), changed);
+      handled(kind, changed, rx.line(), rx.length());
+    }
+    return result;
+  }
+};
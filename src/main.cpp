@@ -8,9 +8,23 @@
 #include <PinButton.h>
 #include <Webserver.h>
 #include <Ministache.h>
+#include <SPIFFS.h>
+#include <esp_task_wdt.h>
+#include <esp_heap_caps.h>
+#include <lwip/sockets.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
 #include <string>
 
+#include "vmix_protocol.h"
+#include "capture.h"
+#include "glyph_atlas.h"
+#include "health.h"
+#include "event_stream.h"
+
 // types...
 enum class Screen {
   TALLY,
@@ -19,7 +33,8 @@ enum class Screen {
   SETTINGS_QR,
   AP,
   _,
-  TALLY_SET
+  TALLY_SET,
+  HEALTH,
 };
 
 enum class Mode {
@@ -27,11 +42,298 @@ enum class Mode {
   ACTS,
 };
 
-enum Tally {
-  SAFE,
-  PGM,
-  PRV,
-  UNKNOWN,
+// How tally is derived when a backup vMix is configured.
+enum class VmixPolicy {
+  FAILOVER, // follow the primary while it is alive, else the secondary
+  MERGE,    // combine both: PGM over PRV over SAFE
+};
+
+// Bump allocator for scratch strings that only live for one frame.
+// Reset at the top of every Engine::update(), so nothing formatted here
+// touches the heap.
+template <size_t N>
+class FrameArena {
+  char buf[N];
+  size_t used = 0;
+  size_t high = 0;
+
+public:
+  void reset() { used = 0; }
+  size_t capacity() const { return N; }
+  size_t highWater() const { return high; }
+
+  const char* printf(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    char* dst = buf + used;
+    size_t left = N - used;
+    int n = vsnprintf(dst, left, fmt, args);
+    va_end(args);
+    if (n < 0 || left == 0) {
+      return "";
+    }
+    // truncated output still consumes the rest of the arena
+    used += (size_t)n < left ? (size_t)n + 1 : left;
+    if (used > high) {
+      high = used;
+    }
+    return dst;
+  }
+};
+
+// Heap telemetry, sampled from update(). min_free and max_alloc are the
+// numbers to watch over a long show: min_free only goes down, and a shrinking
+// max_alloc at a stable free size means fragmentation. blocks is the number
+// of live allocations; once the surface is up it should stay flat.
+struct HeapStats {
+  uint32_t free = 0;
+  uint32_t min_free = 0;
+  uint32_t max_alloc = 0;
+  uint32_t min_max_alloc = UINT32_MAX;
+  uint32_t blocks = 0;
+  uint32_t max_blocks = 0;
+
+  void sample() {
+    free = ESP.getFreeHeap();
+    min_free = ESP.getMinFreeHeap();
+    max_alloc = ESP.getMaxAllocHeap();
+    if (max_alloc < min_max_alloc) {
+      min_max_alloc = max_alloc;
+    }
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+    blocks = info.allocated_blocks;
+    if (blocks > max_blocks) {
+      max_blocks = blocks;
+    }
+  }
+};
+
+// One subscribed connection to a vMix TCP API. Engine keeps one for the
+// primary vMix and one for the optional backup.
+struct VmixLink {
+  const char* label;
+  char host[64] = "";
+  uint16_t port = 8099;
+  WiFiClient client;
+  bool connected = false;
+  // has sent its tally since connecting; until then it cannot drive one
+  bool synced = false;
+
+  // line assembly, parsed tally/ACTS state and the hand-off to the
+  // capture, see vmix_protocol.h
+  VmixReceiver receiver;
+
+  unsigned long last_rx = 0;
+  unsigned long last_probe = 0;
+  unsigned long last_attempt = 0;
+  // socket of a startConnect() still in progress, or -1
+  int connecting_fd = -1;
+  uint32_t connects = 0;
+  uint32_t drops = 0;
+
+  // VERSION probe round trip: send times of the unanswered probes, oldest
+  // first. vMix answers commands in order, so each VERSION OK is the reply
+  // to the oldest one.
+  static const uint8_t MAX_PROBES = 8;
+  unsigned long probe_sent_us[MAX_PROBES];
+  uint8_t probe_first = 0;
+  uint8_t probes_pending = 0;
+  uint32_t rtt_us = 0;
+  uint32_t rtt_min_us = UINT32_MAX;
+  uint32_t rtt_max_us = 0;
+  uint32_t rtt_avg_us = 0;
+  // recent worst round trip: follows spikes at once, halves in ~180 probes
+  uint32_t rtt_peak_us = 0;
+
+  // probed at FAILOVER_PROBE_MS because it drives the tally, since fast_since
+  bool fast = false;
+  unsigned long fast_since = 0;
+
+  explicit VmixLink(const char* label) : label(label) {}
+
+  bool configured() const { return host[0] != '\0'; }
+
+  // Time since the link was last heard from. A stamp taken after the
+  // caller read now (a connect that finished later) counts as just heard.
+  unsigned long silence(unsigned long now) const {
+    unsigned long age = now - last_rx;
+    return (long)age < 0 ? 0 : age;
+  }
+
+  // address is "host" or "host:port"
+  void configure(const char* address, uint16_t default_port) {
+    strncpy(host, address, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    port = default_port;
+    char* colon = strchr(host, ':');
+    if (colon) {
+      *colon = '\0';
+      int p = atoi(colon + 1);
+      if (p > 0 && p <= 0xFFFF) {
+        port = (uint16_t)p;
+      }
+    }
+  }
+
+  // Blocking connect, for the foreground connect and recovery.
+  bool connect(int32_t timeout_ms) {
+    cancelConnect();
+    last_attempt = millis();
+    if (!configured() || !client.connect(host, port, timeout_ms)) {
+      return false;
+    }
+    established(millis());
+    return true;
+  }
+
+  bool connecting() const { return connecting_fd >= 0; }
+
+  // Start a connect that does not block the loop; pollConnect() finishes
+  // it. Only a host name (not an IP address) waits, for DNS.
+  bool startConnect(unsigned long now) {
+    cancelConnect();
+    last_attempt = now;
+    IPAddress ip;
+    if (!configured() || (!ip.fromString(host) && !WiFi.hostByName(host, ip))) {
+      return false;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+      return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    if (::connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+      close(fd);
+      return false;
+    }
+    connecting_fd = fd;
+    return true;
+  }
+
+  // Check a startConnect() without waiting. Returns true once connected;
+  // a refused or timed out attempt is closed and returns false.
+  bool pollConnect(unsigned long now, unsigned long timeout_ms) {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(connecting_fd, &writable);
+    struct timeval tv = {0, 0};
+    int ready = select(connecting_fd + 1, nullptr, &writable, nullptr, &tv);
+    if (ready == 0) {
+      if (now - last_attempt >= timeout_ms) {
+        cancelConnect();
+      }
+      return false;
+    }
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (ready < 0 || getsockopt(connecting_fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+      cancelConnect();
+      return false;
+    }
+    // WiFiClient expects a blocking socket, as its own connect() leaves it
+    fcntl(connecting_fd, F_SETFL, fcntl(connecting_fd, F_GETFL, 0) & ~O_NONBLOCK);
+    client = WiFiClient(connecting_fd);
+    connecting_fd = -1;
+    established(now);
+    return true;
+  }
+
+  void cancelConnect() {
+    if (connecting_fd >= 0) {
+      close(connecting_fd);
+      connecting_fd = -1;
+    }
+  }
+
+  void established(unsigned long now) {
+    client.setNoDelay(true);
+    connected = true;
+    synced = false;
+    receiver.rx.reset();
+    receiver.state.tally_states[0] = '\0';
+    last_rx = last_probe = now;
+    probes_pending = 0;
+    connects++;
+    subscribe();
+  }
+
+  void subscribe() {
+    // Subscribe to the tally events, and fetch the current tally once
+    client.println("SUBSCRIBE TALLY");
+    client.println("SUBSCRIBE ACTS");
+    client.println("TALLY");
+  }
+
+  void drop() {
+    client.stop();
+    if (connected) {
+      drops++;
+    }
+    connected = false;
+    synced = false;
+    probes_pending = 0;
+    fast = false;
+    receiver.state.tally_states[0] = '\0';
+  }
+
+  // Ask for the version so a quiet link still answers. VERSION OK is only
+  // ever a reply, unlike TALLY OK, which subscription updates also send.
+  // With MAX_PROBES unanswered the link is long past any silence limit, so
+  // no more are queued on it.
+  void probe(unsigned long now) {
+    last_probe = now;
+    if (probes_pending == MAX_PROBES) {
+      return;
+    }
+    probe_sent_us[(probe_first + probes_pending) % MAX_PROBES] = micros();
+    probes_pending++;
+    client.print("VERSION\r\n");
+  }
+
+  // Called for every VERSION OK. The round trip is measured to when the
+  // loop reads the reply, so it includes up to one loop period of waiting
+  // on top of the network and vMix time.
+  void probeAnswered() {
+    if (probes_pending == 0) {
+      return;
+    }
+    rtt_us = micros() - probe_sent_us[probe_first];
+    probe_first = (probe_first + 1) % MAX_PROBES;
+    probes_pending--;
+    if (rtt_us < rtt_min_us) {
+      rtt_min_us = rtt_us;
+    }
+    if (rtt_us > rtt_max_us) {
+      rtt_max_us = rtt_us;
+    }
+    rtt_avg_us = rtt_avg_us ? (rtt_avg_us * 7 + rtt_us) / 8 : rtt_us;
+    rtt_peak_us = rtt_us > rtt_peak_us ? rtt_us : rtt_peak_us - rtt_peak_us / 256;
+  }
+
+  // Drain the socket through the receiver, see VmixReceiver::push() for
+  // record and handled. Never blocks: a partial line stays buffered until
+  // the next call.
+  template <typename Record, typename Handled>
+  void poll(unsigned long now, Record record, Handled handled) {
+    // a discarded line still shows the link is alive
+    auto stamp = [&](const char* line, size_t len, bool complete) {
+      last_rx = now;
+      record(line, len, complete);
+    };
+    while (client.available()) {
+      int c = client.read();
+      if (c < 0) {
+        break;
+      }
+      receiver.push((char)c, stamp, handled);
+    }
+  }
 };
 
 class Engine : public Task::Base {
@@ -41,11 +343,9 @@ class Engine : public Task::Base {
   PinButton btnC;
 
   // WiFi(server)
-  String ssid_prefix = "vt-";
+  const char* ssid_prefix = "vt-";
   char ssid[12] = "";
   char password[20] = "";
-  // HTTP Header
-  String header;
 
   // state
   bool vmix_connected = false;
@@ -55,9 +355,71 @@ class Engine : public Task::Base {
   int tally_target = 0;
   int current_input = 0; // only available in ACTS mode or XML API
 
+  // vMix links (primary, secondary) and arbitration between them
+  VmixLink links[2] = {VmixLink("primary"), VmixLink("secondary")};
+  VmixLink* active_link = nullptr;
+  VmixPolicy policy = VmixPolicy::FAILOVER;
+  unsigned long failover_ms = 0; // 0: derived, see failoverThreshold()
+  uint32_t failovers = 0;
+  unsigned long last_failover_ms = 0;
+  // the boot connect blocks for this long; recovery and the standby
+  // connect in the background, see VmixLink::startConnect()
+  const int32_t VMIX_CONNECT_TIMEOUT_MS = 3000;
+  const unsigned long STANDBY_RETRY_MS = 1000;
+  // With a backup configured, the links that drive the tally (the active
+  // one for failover, both for merge) get a VERSION probe every
+  // FAILOVER_PROBE_MS: about 33 requests/s from every surface to that vMix,
+  // each answered with one VERSION OK line. A standby is only probed at
+  // HealthMonitor::PROBE_INTERVAL_MS (0.5 requests/s).
+  const unsigned long FAILOVER_PROBE_MS = 30;
+  const unsigned long FAILOVER_MARGIN_MS = 10;
+  const unsigned long FAILOVER_MIN_MS = 50;
+  const unsigned long FAILOVER_MAX_MS = 250;
+
+  // raw vMix traffic capture (SPIFFS), see capture.h
+  CaptureLog capture;
+  CaptureDownload download;
+
+  // large tally labels, see glyph_atlas.h
+  GlyphAtlas atlas;
+
+  // Render time per tally label, reported in /status. scaled_us is the
+  // setTextSize(10) path the atlas replaced, timed once on the label's
+  // first draw so there is something to compare against.
+  struct LabelTiming {
+    const char* label;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t scaled_us;
+  };
+  LabelTiming label_timings[4] = {
+    {"SAFE", 0, 0, 0}, {"PGM", 0, 0, 0}, {"PRV", 0, 0, 0}, {"?", 0, 0, 0},
+  };
+
+  // health monitor and task watchdog, see health.h
+  HealthMonitor health;
+  bool engine_ready = false;
+  bool watchdog_running = false;
+  unsigned long last_wifi_check = 0;
+  unsigned long last_health_draw = 0;
+  const unsigned long WIFI_CHECK_INTERVAL_MS = 5000;
+  const int WDT_TIMEOUT_S = 30;
+  char json_buf[1280];
+
+  // GET /status and the /events stream, see event_stream.h
+  EventStream events;
+  char status_buf[1280];
+  unsigned long last_status_push = 0;
+  const unsigned long STATUS_INTERVAL_MS = 1000;
+
+  // per-frame scratch and heap telemetry
+  FrameArena<256> arena;
+  HeapStats heap;
+  unsigned long last_heap_log = 0;
+  const unsigned long HEAP_LOG_INTERVAL_MS = 60000;
+
   // Instances
   DNSServer dnsServer;
-  WiFiClient client;
   WebServer server;
   std::shared_ptr<M5Canvas> sprite;
 
@@ -65,7 +427,7 @@ class Engine : public Task::Base {
   Preferences preferences;
   Mode mode = Mode::TALLY;
   const int VMIX_PORT = 8099;
-  String ACTS_EVENT = "InputPreview";
+  const char* ACTS_EVENT = "InputPreview";
   int ACTS_EVENT_NR = 1;
   int ACTS_EVENT_TARGET = 1;
 
@@ -89,46 +451,70 @@ class Engine : public Task::Base {
   }
 
   // buttons
-  void printBtnA(String s){
+  void printBtnA(const char* s){
     sprite->setCursor(40, 220);
     sprite->print(s);
   }
-  void printBtnB(String s){
+  void printBtnB(const char* s){
     sprite->setCursor(145, 220);
     sprite->print(s);
   }
-  void printBtnC(String s){
+  void printBtnC(const char* s){
     sprite->setCursor(240, 220);
     sprite->print(s);
   }
 
-  // utility functions
-  Tally parseTallyInt(char c) {
-    switch (c) {
-      case '0':
-        return Tally::SAFE;
-      case '1':
-        return Tally::PGM;
-      case '2':
-        return Tally::PRV;
-      default:
-        return Tally::UNKNOWN;
+  LabelTiming* labelTiming(const char* state) {
+    for (auto& t : label_timings) {
+      if (strcmp(t.label, state) == 0) {
+        return &t;
+      }
     }
-  };
+    return nullptr;
+  }
+
+  // The built-in font scaled up, as labels were drawn before the atlas.
+  uint32_t drawScaledLabel(int x, int y, const char* state) {
+    uint32_t start = micros();
+    sprite->setTextSize(10);
+    sprite->setCursor(x, y);
+    sprite->println(state);
+    return micros() - start;
+  }
 
   // Handle Tally State
-  void displayTallyState(uint16_t bgcolor, uint16_t color, int x, int y, String state){
+  // x/y are only used by the scaled font
+  void displayTallyState(uint16_t bgcolor, uint16_t color, int x, int y, const char* state){
     sprite->fillScreen(bgcolor);
     sprite->setTextColor(color, bgcolor);
-    sprite->setCursor(x, y);
-    sprite->println(state);
+    LabelTiming* timing = labelTiming(state);
+    if (!atlas.canDraw(state)) {
+      uint32_t us = drawScaledLabel(x, y, state);
+      if (timing) {
+        timing->scaled_us = us;
+      }
+      return;
+    }
+    if (timing && timing->scaled_us == 0) {
+      // once per label, then painted over by the atlas below
+      timing->scaled_us = drawScaledLabel(x, y, state);
+      sprite->fillScreen(bgcolor);
+    }
+    uint32_t us = atlas.drawCentered(*sprite, state, sprite->width()/2, sprite->height()/2, color, bgcolor);
+    if (timing) {
+      timing->last_us = us;
+      if (us > timing->max_us) {
+        timing->max_us = us;
+      }
+    }
   }
 
   // Menus
   // Show the current network settings
   void showNetworkScreen() {
+    char wifi_ssid[33] = "";
     preferences.begin("vMixTally", true);
-    auto WIFI_SSID = preferences.getString("wifi_ssid", "");
+    preferences.getString("wifi_ssid", wifi_ssid, sizeof(wifi_ssid));
     preferences.end();
 
     Serial.println("Showing Network screen");
@@ -138,10 +524,23 @@ class Engine : public Task::Base {
     sprite->setTextSize(2);
     sprite->setTextColor(WHITE, BLACK);
     sprite->println();
-    sprite->printf("SSID: %s\n", WIFI_SSID);
-    sprite->printf("IP Address: %s\n", WiFi.localIP().toString());
+    auto ip = WiFi.localIP();
+    sprite->printf("SSID: %s\n", wifi_ssid);
+    sprite->printf("IP Address: %u.%u.%u.%u\n", ip[0], ip[1], ip[2], ip[3]);
     sprite->printf("Camera Num: %d\n", tally_target);
+    sprite->println();
+    heap.sample();
+    sprite->printf("Heap: %u free\n", heap.free);
+    sprite->printf("  min: %u\n", heap.min_free);
+    sprite->printf("  max blk: %u\n", heap.max_alloc);
+    sprite->printf("  blocks: %u\n", heap.blocks);
+    sprite->println("Label max us (scaled):");
+    for (const auto& t : label_timings) {
+      sprite->printf(" %s %u (%u)", t.label, (unsigned)t.max_us, (unsigned)t.scaled_us);
+    }
+    sprite->println();
     printBtnA("BACK");
+    printBtnC("HEALTH");
   }
 
   void showSettingsQRCode() {
@@ -161,8 +560,7 @@ class Engine : public Task::Base {
 
     // TODO: Split method / destructor
 
-    char buf[61];
-    auto qr = sprintf(buf, "WIFI:T:WPA;S:%s;P:%s;H:false;;", ssid, password);
+    auto buf = arena.printf("WIFI:T:WPA;S:%s;P:%s;H:false;;", ssid, password);
     Serial.printf("QR Code: %s\n", buf);
     sprite->println();
     sprite->println();
@@ -182,7 +580,6 @@ class Engine : public Task::Base {
     }
 
     currentState = Screen::TALLY;
-    sprite->setTextSize(10);
     if (mode == Mode::TALLY) {
     Serial.println("Tally Mode");
       switch (currentTally) {
@@ -213,6 +610,12 @@ class Engine : public Task::Base {
     Serial.println("Print Target done");
     sprite->printf("ACTIVE: %d\n", current_input);
     Serial.println("Print Active done");
+    if (redundant()) {
+      sprite->printf("SRC: %s\n", active_link ? active_link->label : "-");
+    }
+    if (capture.isEnabled()) {
+      sprite->println("REC");
+    }
     Serial.println("Draw sprite done. Drawing Buttons...");
     printBtnA("TALLY");
     printBtnB("SET");
@@ -232,11 +635,98 @@ class Engine : public Task::Base {
     sprite->printf("Current Target: %d\n", tally_target);
     sprite->setCursor(20,60);
 
+    auto num = arena.printf("%d", tally_target);
+    if (atlas.canDraw(num)) {
+      atlas.drawCentered(*sprite, num, sprite->width()/2, 130, WHITE, BLACK);
+    }
+
     printBtnA("OK");
     printBtnB("-");
     printBtnC("+");
   }
 
+  // Health counters. Refreshed once a second while shown.
+  void showHealthScreen() {
+    unsigned long now = millis();
+    currentState = Screen::HEALTH;
+    last_health_draw = now;
+    clearLCD();
+    sprite->fillScreen(TFT_BLACK);
+    sprite->setTextSize(2);
+    sprite->setTextColor(WHITE, BLACK);
+    sprite->printf("Health  up:%lus\n", now / 1000);
+    sprite->printf("%-6s%6s%8s%4s\n", "", "age", "max us", "ovr");
+    for (int i = 0; i < HealthMonitor::SUBSYSTEM_COUNT; i++) {
+      auto sub = (HealthMonitor::Subsystem)i;
+      const auto& st = health.subsystems[i];
+      if (health.hasHeartbeat(sub)) {
+        sprite->printf("%-6s%5lus%8u%4u\n", HealthMonitor::name(sub), health.age(sub, now) / 1000,
+          (unsigned)st.max_us, (unsigned)st.overruns);
+      } else {
+        sprite->printf("%-6s%6s%8u%4u\n", HealthMonitor::name(sub), "-",
+          (unsigned)st.max_us, (unsigned)st.overruns);
+      }
+    }
+    sprite->printf("%-6s%6s%8u%4u\n", "loop", "", (unsigned)health.loop_max_us, (unsigned)health.loop_overruns);
+    sprite->println();
+    sprite->printf("resub:%u recon:%u\n",
+      (unsigned)health.actions[HealthMonitor::RESUBSCRIBE], (unsigned)health.actions[HealthMonitor::RECONNECT]);
+    sprite->printf("wifi:%u reboot:%u\n",
+      (unsigned)health.actions[HealthMonitor::WIFI_RESTART], (unsigned)health.reboots);
+    sprite->printf("server:%u wdt:%u\n",
+      (unsigned)health.actions[HealthMonitor::SERVER_RESTART], (unsigned)health.watchdog_resets);
+    printBtnA("BACK");
+  }
+
+  // Redraw whatever screen is shown, e.g. after a recovery action drew over it.
+  void redraw() {
+    switch (currentState) {
+      case Screen::TALLY:
+        if (vmix_connected) {
+          showTallyScreen();
+          return;
+        }
+        showMsg("vMix disconnected. Reconnecting...");
+        break;
+      case Screen::NETWORK:
+        showNetworkScreen();
+        break;
+      case Screen::SETTINGS:
+        showSettingsScreen();
+        break;
+      case Screen::TALLY_SET:
+        showTallySetScreen();
+        break;
+      case Screen::HEALTH:
+        showHealthScreen();
+        break;
+      default:
+        return;
+    }
+    sprite->pushSprite(0, 0);
+  }
+
+void startWatchdog() {
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+  esp_task_wdt_config_t cfg = {
+    .timeout_ms = (uint32_t)WDT_TIMEOUT_S * 1000,
+    .idle_core_mask = 0,
+    .trigger_panic = true,
+  };
+  esp_task_wdt_reconfigure(&cfg);
+#else
+  esp_task_wdt_init(WDT_TIMEOUT_S, true);
+#endif
+  esp_task_wdt_add(NULL);
+  watchdog_running = true;
+}
+
+void feedWatchdog() {
+  if (watchdog_running) {
+    esp_task_wdt_reset();
+  }
+}
+
 boolean connectToWifi() {
   int count = 0;
   while (WiFi.status() != WL_CONNECTED) {
@@ -248,13 +738,69 @@ boolean connectToWifi() {
     sprite->printf("WiFi failed(%d) retry...\n", count);
     sprite->pushSprite(0, 0);
     delay(5000);
+    feedWatchdog();
   }
   Serial.println("Connected to WiFi!");
   count = 0;
   return true;
 }
 
-boolean connectTovMix() {
+bool redundant() const {
+  return links[1].configured();
+}
+
+void updateConnected() {
+  vmix_connected = links[0].connected || links[1].connected;
+}
+
+// Load both vMix addresses and the arbitration settings from Preferences.
+void loadLinks() {
+  char address[64] = "";
+  preferences.begin("vMixTally", true);
+  preferences.getString("vmix_ip", address, sizeof(address));
+  links[0].configure(address, VMIX_PORT);
+  address[0] = '\0';
+  preferences.getString("vmix_ip2", address, sizeof(address));
+  links[1].configure(address, VMIX_PORT);
+  policy = preferences.getUChar("vmix_policy", 0) == 1 ? VmixPolicy::MERGE : VmixPolicy::FAILOVER;
+  failover_ms = preferences.getUInt("failover_ms", 0);
+  preferences.end();
+  if (failover_ms > 0 && !validFailoverMs(failover_ms)) {
+    failover_ms = 0;
+  }
+}
+
+// failover_ms setting: 0 for a derived threshold, else FAILOVER_MIN_MS..FAILOVER_MAX_MS
+bool validFailoverMs(unsigned long ms) const {
+  return ms == 0 || (ms >= FAILOVER_MIN_MS && ms <= FAILOVER_MAX_MS);
+}
+
+// Parse a failover_ms setting; false for anything but a valid number.
+bool parseFailoverMs(const char* text, unsigned long& ms) const {
+  char* end;
+  long v = strtol(text, &end, 10);
+  if (end == text || *end != '\0' || v < 0 || !validFailoverMs((unsigned long)v)) {
+    return false;
+  }
+  ms = (unsigned long)v;
+  return true;
+}
+
+// One connect attempt on every configured link that is down.
+bool connectLinks(int32_t timeout_ms) {
+  for (auto& link : links) {
+    if (link.configured() && !link.connected && link.connect(timeout_ms)) {
+      Serial.printf("Connected to vMix %s at %s:%u\n", link.label, link.host, link.port);
+      health.beat(HealthMonitor::VMIX, millis());
+    }
+  }
+  updateConnected();
+  return vmix_connected;
+}
+
+// Blocking connect at boot. retries: extra attempts one second apart.
+// Recovery in the loop connects in the background instead.
+boolean connectTovMix(int retries = 10) {
   if (vmix_connecting) {
     return false;
   }
@@ -266,90 +812,334 @@ boolean connectTovMix() {
   clearLCD();
   sprite->println("Connecting to vMix...");
 
-  preferences.begin("vMixTally", true);
-  
-  auto VMIX_IP = preferences.getString("vmix_ip"); 
-  preferences.end();
   int count = 0;
-  while (0 == client.connect(VMIX_IP.c_str(),VMIX_PORT)) {
-    Serial.printf("failed to connect vMix. at %s. Retrying...\n", VMIX_IP);
+  while (!connectLinks(VMIX_CONNECT_TIMEOUT_MS)) {
+    Serial.printf("failed to connect vMix. at %s. Retrying...\n", links[0].host);
     count++;
     sprite->printf("vMix Connection failed(%d) retry...\n", count);
-    delay(1000);
-    if (count > 10) {
+    if (count > retries) {
       vmix_connecting = false;
       return false;
     }
+    delay(1000);
+    feedWatchdog();
     sprite->pushSprite(0, 0);
   }
-  vmix_connected = true;
   Serial.println("Connected to vMix!");
   Serial.println("------------");
 
-  // Subscribe to the tally events
-  client.println("SUBSCRIBE TALLY");
-  client.println("SUBSCRIBE ACTS");
   vmix_connecting = false;
   return true;
 }
 
 // Handle incoming data
-void handleData(String data) {
-    Serial.printf("EVENT(RAW): %s\n",data);
-  // Check if server data is tally data
-  if (data.indexOf("TALLY OK") == 0) {
-    // Pick the state of the current tally
-    data = data.substring(sizeof("TALLY OK"));
-    auto target = data.charAt(tally_target -1);
-    auto newState = parseTallyInt(target);
-    Serial.printf("target:%c newState:%c\n", target, newState);
-    currentTally = newState;
-    
-    if (mode != Mode::TALLY) {
+// `data` is one line from the vMix TCP API without the trailing CR/LF,
+// already parsed into the link's state by VmixReceiver; arbitrate()
+// decides what is shown. Nothing here allocates.
+void handleData(VmixLink& link, VmixState::Kind kind, bool changed, const char* data) {
+  if (kind == VmixState::VERSION) {
+    // a probe reply, many times a second: only timed
+    link.probeAnswered();
+    return;
+  }
+  if (kind == VmixState::TALLY) {
+    link.synced = true;
+    // resubscribing repeats the TALLY OK; only log changes
+    if (!changed) {
       return;
     }
-    
-    if (currentState == Screen::TALLY) {
-      showTallyScreen();
-      return;
+    // The capture keeps the line; printing a 1000-input one would hold
+    // the UART for about 90 ms.
+    Serial.printf("vMix %s: tally of %u inputs, target %s\n",
+      link.label, (unsigned)strlen(link.receiver.state.tally_states), tallyName(linkTally(link)));
+    return;
+  }
+
+  if (kind == VmixState::ACTS) {
+    Serial.printf("vMix %s: event:%s input:%d target:%d\n",
+      link.label, link.receiver.state.acts_event, link.receiver.state.acts_input, link.receiver.state.acts_target);
+  }
+  else {
+    Serial.printf("Response from vMix %s: %.48s\n", link.label, data);
+  }
+}
+
+// Drain every connected vMix link. now is the loop's time: the link and
+// heartbeat stamps must not be newer than the now later age checks use.
+void pollvMix(unsigned long now) {
+  for (uint8_t i = 0; i < 2; i++) {
+    VmixLink& link = links[i];
+    if (!link.connected) {
+      continue;
     }
+    link.poll(now,
+      [&](const char* line, size_t len, bool complete) {
+        health.beat(HealthMonitor::VMIX, now);
+        // every line as received, repeats, probe replies and overlong ones
+        // included, so the capture can reproduce what the parser saw
+        capture.record(now, CaptureRecord::lineSource(i, complete), line, len);
+      },
+      [&](VmixState::Kind kind, bool changed, const char* line, size_t) {
+        handleData(link, kind, changed, line);
+      });
   }
+}
 
-  // Check if server data is ACTS data
-  else if (data.indexOf("ACTS OK") == 0) {
-    // Throw away first 8 characters(ACTS OK )
-    data = data.substring(8);
+Tally linkTally(const VmixLink& link) const {
+  return link.receiver.state.tally(tally_target);
+}
 
-    int spaceIndex = data.indexOf(" ");
-    String event = data.substring(0, spaceIndex);
-    Serial.printf("event:%s ", &(event[0]));
+static int tallyRank(Tally t) {
+  switch (t) {
+    case PGM: return 3;
+    case PRV: return 2;
+    case SAFE: return 1;
+    default: return 0;
+  }
+}
+
+// With a backup configured, the links whose data is shown: their silence
+// has to be noticed within failoverThreshold().
+bool drivesTally(const VmixLink& link) const {
+  return redundant() && (policy == VmixPolicy::MERGE || &link == &links[0] || &link == active_link);
+}
 
-    auto remainingData = data.substring(spaceIndex + 1, data.length());
-    spaceIndex = remainingData.indexOf(" ");
-    int input = remainingData.substring(0, spaceIndex).toInt(); // sometimes float
-    Serial.printf("input:%d ", input);
+// Silence after which a fast-probed link counts as dead. Unless set in the
+// settings, it is derived from what was measured: one probe interval, the
+// worst recent probe round trip (which includes the wait for the loop to
+// read the reply), the worst recent loop (a probe goes out late by up to
+// one loop) and a margin.
+unsigned long failoverThreshold(const VmixLink& link) const {
+  if (failover_ms > 0) {
+    return failover_ms;
+  }
+  unsigned long ms = FAILOVER_PROBE_MS + link.rtt_peak_us / 1000 + health.loop_peak_us / 1000 + FAILOVER_MARGIN_MS;
+  return ms < FAILOVER_MIN_MS ? FAILOVER_MIN_MS : ms > FAILOVER_MAX_MS ? FAILOVER_MAX_MS : ms;
+}
+
+// How long a link may be silent and still count as alive.
+unsigned long silenceLimit(const VmixLink& link) const {
+  return link.fast ? failoverThreshold(link) : health.subsystems[HealthMonitor::VMIX].timeout_ms;
+}
 
-    remainingData = remainingData.substring(spaceIndex + 1, remainingData.length());
-    int target = remainingData.toInt();
-    Serial.printf("target:%d\n", target);
+// A link counts for arbitration once it has sent its tally and, with a
+// backup configured, while it has been heard from within silenceLimit().
+// A link that has just become fast-probed is timed from then, not from the
+// last reply to the slow standby probe.
+bool linkAlive(const VmixLink& link, unsigned long now) const {
+  if (!link.connected || !link.synced) {
+    return false;
+  }
+  if (!redundant()) {
+    return true;
+  }
+  unsigned long age = link.silence(now);
+  if (link.fast && now - link.fast_since < age) {
+    age = now - link.fast_since;
+  }
+  return age <= silenceLimit(link);
+}
 
-    if (event == "Input" && target == 1) {
-      current_input = input;
+// Pick the link that drives the surface and derive the shown tally from
+// the policy. Redraws the tally screen when anything visible changed.
+void arbitrate(unsigned long now) {
+  bool alive0 = linkAlive(links[0], now);
+  bool alive1 = linkAlive(links[1], now);
+  VmixLink* source = alive0 ? &links[0] : alive1 ? &links[1] : nullptr;
+  Tally tally = source ? linkTally(*source) : Tally::UNKNOWN;
+  if (policy == VmixPolicy::MERGE && alive0 && alive1) {
+    Tally other = linkTally(links[1]);
+    if (tallyRank(other) > tallyRank(tally)) {
+      tally = other;
     }
-    
-    Serial.printf("Apply ACTS Tally for target: %d\n", target);
-    if (currentState == Screen::TALLY) {
-      if (target == ACTS_EVENT_TARGET) {
-        showTallyScreen();
-        return;
-      }
-      showTallyScreen();
+  }
+
+  bool changed = false;
+  if (source != active_link) {
+    if (active_link && source && !linkAlive(*active_link, now)) {
+      failovers++;
+      last_failover_ms = active_link->silence(now);
+      Serial.printf("vMix failover %s -> %s, %lums after last data\n",
+        active_link->label, source->label, last_failover_ms);
+    } else if (active_link && source) {
+      // the primary is back and synced; not a failure, so not counted
+      Serial.printf("vMix failback %s -> %s\n", active_link->label, source->label);
     }
+    active_link = source;
+    changed = true;
   }
-  else {
-    Serial.print("Response from vMix: ");
-    Serial.println(data);
+  int input = source ? source->receiver.state.current_input : current_input;
+  if (tally == currentTally && input == current_input && !changed) {
+    return;
   }
+  currentTally = tally;
+  current_input = input;
+  if (currentState == Screen::TALLY) {
+    redraw();
+  }
+  publishStatus(now);
+}
+
+// Keep every configured link probed, drop dead ones, finish background
+// connects and, with a backup configured, reconnect the standby.
+void maintainLinks(unsigned long now) {
+  for (auto& link : links) {
+    if (!link.configured()) {
+      continue;
+    }
+    if (link.connected && !link.client.connected()) {
+      Serial.printf("vMix %s connection lost\n", link.label);
+      link.drop();
+    }
+    // A single link is left to the graded recovery in checkHealth();
+    // with a backup, a long-silent link is torn down and retried here.
+    if (link.connected && redundant() &&
+        link.silence(now) > health.subsystems[HealthMonitor::VMIX].timeout_ms) {
+      Serial.printf("vMix %s silent. Dropping\n", link.label);
+      link.drop();
+    }
+    bool fast = link.connected && drivesTally(link);
+    if (fast && !link.fast) {
+      link.fast_since = now;
+      link.probe(now);
+    }
+    link.fast = fast;
+    unsigned long interval = fast ? FAILOVER_PROBE_MS : HealthMonitor::PROBE_INTERVAL_MS;
+    if (link.connected && now - link.last_probe >= interval) {
+      link.probe(now);
+    }
+    // finish connects started here or by the RECONNECT recovery step
+    if (link.connecting() && link.pollConnect(now, VMIX_CONNECT_TIMEOUT_MS)) {
+      Serial.printf("Connected to vMix %s at %s:%u\n", link.label, link.host, link.port);
+      health.beat(HealthMonitor::VMIX, now);
+    }
+    if (!link.connected && !link.connecting() && redundant() && now - link.last_attempt >= STANDBY_RETRY_MS) {
+      link.startConnect(now);
+    }
+  }
+  updateConnected();
+}
+
+static const char* tallyName(Tally t) {
+  switch (t) {
+    case SAFE: return "SAFE";
+    case PGM: return "PGM";
+    case PRV: return "PRV";
+    default: return "UNKNOWN";
+  }
+}
+
+// GET /status and the "status" event: what the surface shows, where it
+// comes from, and how healthy that path is.
+size_t statusToJson(char* buf, size_t len, unsigned long now) {
+  heap.sample();
+  int n = snprintf(buf, len,
+    "{\"uptime_ms\":%lu,\"tally\":\"%s\",\"target\":%d,\"input\":%d,"
+    "\"vmix\":{\"connected\":%s,\"active\":\"%s\",\"failovers\":%u,\"last_failover_ms\":%lu,\"links\":[",
+    now, tallyName(currentTally), tally_target, current_input,
+    vmix_connected ? "true" : "false", active_link ? active_link->label : "",
+    (unsigned)failovers, last_failover_ms);
+  if (n < 0 || (size_t)n >= len) {
+    return 0;
+  }
+  size_t pos = n;
+  for (int i = 0; i < 2; i++) {
+    const VmixLink& link = links[i];
+    if (!link.configured()) {
+      continue;
+    }
+    n = snprintf(buf + pos, len - pos,
+      "%s{\"label\":\"%s\",\"connected\":%s,\"alive\":%s,\"age_ms\":%lu,"
+      "\"rtt_us\":%u,\"rtt_min_us\":%u,\"rtt_max_us\":%u,\"rtt_avg_us\":%u}",
+      i ? "," : "", link.label,
+      link.connected ? "true" : "false", linkAlive(link, now) ? "true" : "false",
+      link.connected ? link.silence(now) : 0,
+      (unsigned)link.rtt_us, (unsigned)(link.rtt_max_us ? link.rtt_min_us : 0),
+      (unsigned)link.rtt_max_us, (unsigned)link.rtt_avg_us);
+    if (n < 0 || (size_t)n >= len - pos) {
+      return 0;
+    }
+    pos += n;
+  }
+  n = snprintf(buf + pos, len - pos,
+    "]},\"loop\":{\"last_us\":%u,\"max_us\":%u,\"overruns\":%u},"
+    "\"heap\":{\"free\":%u,\"min_free\":%u,\"max_alloc\":%u,\"blocks\":%u},"
+    "\"events\":{\"clients\":%u,\"sent\":%u,\"closed\":%u,\"dropped\":%u,\"refused\":%u},\"labels\":{",
+    (unsigned)health.loop_last_us, (unsigned)health.loop_max_us, (unsigned)health.loop_overruns,
+    (unsigned)heap.free, (unsigned)heap.min_free, (unsigned)heap.max_alloc, (unsigned)heap.blocks,
+    (unsigned)events.clientCount(), (unsigned)events.sent, (unsigned)events.closed, (unsigned)events.dropped, (unsigned)events.refused);
+  if (n < 0 || (size_t)n >= len - pos) {
+    return 0;
+  }
+  pos += n;
+  for (size_t i = 0; i < 4; i++) {
+    const LabelTiming& t = label_timings[i];
+    n = snprintf(buf + pos, len - pos,
+      "%s\"%s\":{\"last_us\":%u,\"max_us\":%u,\"scaled_us\":%u}",
+      i ? "," : "", t.label, (unsigned)t.last_us, (unsigned)t.max_us, (unsigned)t.scaled_us);
+    if (n < 0 || (size_t)n >= len - pos) {
+      return 0;
+    }
+    pos += n;
+  }
+  n = snprintf(buf + pos, len - pos, "}}");
+  if (n < 0 || (size_t)n >= len - pos) {
+    return 0;
+  }
+  return pos + n;
+}
+
+// Push the status to /events subscribers, if there are any.
+void publishStatus(unsigned long now) {
+  last_status_push = now;
+  if (events.clientCount() == 0) {
+    return;
+  }
+  size_t n = statusToJson(status_buf, sizeof(status_buf), now);
+  if (n > 0) {
+    events.publish("status", status_buf, n);
+  }
+}
+
+// GET /vmix: link and arbitration state
+size_t linksToJson(char* buf, size_t len, unsigned long now) {
+  int n = snprintf(buf, len,
+    "{\"policy\":\"%s\",\"failover_ms\":%lu,\"probe_ms\":%lu,\"active\":\"%s\",\"failovers\":%u,\"last_failover_ms\":%lu,\"links\":[",
+    policy == VmixPolicy::MERGE ? "merge" : "failover", failover_ms, FAILOVER_PROBE_MS,
+    active_link ? active_link->label : "", (unsigned)failovers, last_failover_ms);
+  if (n < 0 || (size_t)n >= len) {
+    return 0;
+  }
+  size_t pos = n;
+  for (int i = 0; i < 2; i++) {
+    const VmixLink& link = links[i];
+    n = snprintf(buf + pos, len - pos,
+      "%s{\"label\":\"%s\",\"host\":\"%s\",\"port\":%u,\"connected\":%s,\"alive\":%s,"
+      "\"age_ms\":%lu,\"limit_ms\":%lu,\"fast\":%s,\"rtt_peak_us\":%u,"
+      "\"tally\":%d,\"connects\":%u,\"drops\":%u,\"overlong\":%u}",
+      i ? "," : "", link.label, link.host, link.port,
+      link.connected ? "true" : "false", linkAlive(link, now) ? "true" : "false",
+      link.connected ? link.silence(now) : 0, silenceLimit(link), link.fast ? "true" : "false",
+      (unsigned)link.rtt_peak_us, (int)linkTally(link),
+      (unsigned)link.connects, (unsigned)link.drops, (unsigned)link.receiver.rx.overlong);
+    if (n < 0 || (size_t)n >= len - pos) {
+      return 0;
+    }
+    pos += n;
+  }
+  n = snprintf(buf + pos, len - pos, "]}");
+  if (n < 0 || (size_t)n >= len - pos) {
+    return 0;
+  }
+  return pos + n;
+}
+
+void logHeap() {
+  heap.sample();
+  Serial.printf("HEAP free:%u min_free:%u max_alloc:%u min_max_alloc:%u blocks:%u max_blocks:%u arena_hw:%u/%u overlong:%u\n",
+    heap.free, heap.min_free, heap.max_alloc, heap.min_max_alloc, heap.blocks, heap.max_blocks,
+    (unsigned)arena.highWater(), (unsigned)arena.capacity(),
+    (unsigned)(links[0].receiver.rx.overlong + links[1].receiver.rx.overlong));
 }
 
 void showMsg(const char* msg){
@@ -360,8 +1150,13 @@ void showMsg(const char* msg){
   sprite->println(msg);
 }
 
-void showTallyNum(String msg){
+void showTallyNum(const char* msg){
   clearLCD();
+  if (atlas.canDraw(msg)) {
+    sprite->fillScreen(BLACK);
+    atlas.drawCentered(*sprite, msg, sprite->width()/2, sprite->height()/2, WHITE, BLACK);
+    return;
+  }
   sprite->setTextSize(5);
   sprite->setTextColor(WHITE,BLACK);
   sprite->fillScreen(BLACK);
@@ -373,7 +1168,17 @@ void showSettingsScreen() {
   currentState = Screen::SETTINGS;
   clearLCD();
 
-  preferences.begin("vMixTally", false);
+  char vmix_ip[64] = "";
+  char vmix_ip2[64] = "";
+  char wifi_ssid[33] = "";
+  char wifi_pass[65] = "";
+  preferences.begin("vMixTally", true);
+  preferences.getString("vmix_ip", vmix_ip, sizeof(vmix_ip));
+  preferences.getString("vmix_ip2", vmix_ip2, sizeof(vmix_ip2));
+  preferences.getString("wifi_ssid", wifi_ssid, sizeof(wifi_ssid));
+  preferences.getString("wifi_pass", wifi_pass, sizeof(wifi_pass));
+  auto tally = preferences.getUInt("tally");
+  preferences.end();
   
   sprite->fillScreen(TFT_BLACK);
   sprite->setTextSize(2);
@@ -383,18 +1188,20 @@ void showSettingsScreen() {
   sprite->println();
   sprite->println();
   sprite->println("vMix");
-  sprite->printf("  IP: %s\n", preferences.getString("vmix_ip"));
-  sprite->printf("  CAMERA: %d\n", preferences.getUInt("tally"));
+  sprite->printf("  IP: %s\n", vmix_ip);
+  if (vmix_ip2[0] != '\0') {
+    sprite->printf("  BACKUP: %s\n", vmix_ip2);
+    sprite->printf("  POLICY: %s\n", policy == VmixPolicy::MERGE ? "merge" : "failover");
+  }
+  sprite->printf("  CAMERA: %d\n", tally);
   // sprite->printf("  STATUS: %d\n", preferences.getUInt("tally")); // CONNECTED
   sprite->println();
   
   sprite->println("Network");
-  sprite->printf("  SSID: %s\n", preferences.getString("wifi_ssid")); 
-  sprite->printf("  Password: %s\n", preferences.getString("wifi_pass"));
+  sprite->printf("  SSID: %s\n", wifi_ssid); 
+  sprite->printf("  Password: %s\n", wifi_pass);
   // sprite->printf("  STATUS: %d\n", preferences.getUInt("tally")); // CONNECTED
   sprite->println();
-  
-  preferences.end();
 
   printBtnA("BACK");
   printBtnC("EDIT");
@@ -402,7 +1209,7 @@ void showSettingsScreen() {
 
 void updateTallyNR(int tally){
   preferences.begin("vMixTally", false);
-  if(tally >= 1) {
+  if(tally >= 1 && (size_t)tally <= VMIX_MAX_INPUTS) {
     tally_target =  tally;  
     preferences.putUInt("tally", tally_target);
   }
@@ -416,6 +1223,73 @@ void checkWiFiConnection() {
   }
 }
 
+// Probe the vMix link, watch the servers and run the next recovery step
+// the health monitor asks for.
+void checkHealth(unsigned long now) {
+  if (!engine_ready) {
+    return;
+  }
+  maintainLinks(now);
+  if (now - last_wifi_check >= WIFI_CHECK_INTERVAL_MS) {
+    last_wifi_check = now;
+    checkWiFiConnection();
+  }
+  if (health.needsServerRestart(HealthMonitor::HTTP)) {
+    Serial.println("Health: HTTP server over budget. Restarting");
+    server.stop();
+    server.begin();
+  }
+  if (health.needsServerRestart(HealthMonitor::DNS)) {
+    Serial.println("Health: DNS server over budget. Restarting");
+    dnsServer.stop();
+    dnsServer.start(53, "*", WiFi.softAPIP());
+  }
+
+  auto action = health.nextAction(now, vmix_connected, WiFi.status() == WL_CONNECTED);
+  if (action == HealthMonitor::NONE) {
+    return;
+  }
+  Serial.printf("Health: vMix link %s for %lums. Recovery: %s\n",
+    vmix_connected ? "silent" : "down", health.age(HealthMonitor::VMIX, now), HealthMonitor::name(action));
+  switch (action) {
+    case HealthMonitor::RESUBSCRIBE:
+      for (auto& link : links) {
+        if (link.connected) {
+          link.subscribe();
+        }
+      }
+      break;
+    case HealthMonitor::RECONNECT:
+      // in the background: maintainLinks() finishes the connects, so
+      // buttons and the servers keep running while vMix is away
+      for (auto& link : links) {
+        link.drop();
+        if (link.configured()) {
+          link.startConnect(now);
+        }
+      }
+      updateConnected();
+      break;
+    case HealthMonitor::WIFI_RESTART:
+      for (auto& link : links) {
+        link.drop();
+      }
+      updateConnected();
+      WiFi.disconnect();
+      WiFi.begin();
+      break;
+    case HealthMonitor::REBOOT:
+      preferences.begin("vMixTally", false);
+      preferences.putUInt("reboots", health.reboots + 1);
+      preferences.end();
+      delay(100);
+      ESP.restart();
+      break;
+    default:
+      break;
+  }
+}
+
 public:
     Engine(const String& name)
     : Task::Base(name), btnA(0), btnB(0), btnC(0) {
@@ -423,12 +1297,10 @@ public:
   
         Serial.println("beginning preferences...");
         preferences.begin("vMixTally", true);
-        String ssid = preferences.getString("wifi_ssid");
 
         // TODO: WIFI AP
 
         tally_target = preferences.getUInt("tally");
-        auto VMIX_IP = preferences.getString("vmix_ip");
 
         preferences.end();
         Serial.println("finished preferences...");
@@ -460,6 +1332,53 @@ public:
         return this;
     }
 
+    void sendJson(const char* json, size_t len) {
+      if (len == 0) {
+        server.send(500, "text/plain", "response too large");
+        return;
+      }
+      server.setContentLength(len);
+      server.send(200, "application/json", "");
+      server.sendContent(json, len);
+    }
+
+    // GET /capture: download the raw vMix capture (see capture.h). Only the
+    // headers are sent here; update() streams the body through download.
+    void handleCaptureDownload() {
+      if (!capture.ready()) {
+        server.send(503, "text/plain", "SPIFFS not available");
+        return;
+      }
+      if (download.active()) {
+        server.send(503, "text/plain", "download in progress");
+        return;
+      }
+      size_t size = capture.beginDownload();
+      server.setContentLength(size);
+      server.sendHeader("Content-Disposition", "attachment; filename=\"vmix-capture.bin\"");
+      server.send(200, "application/octet-stream", "");
+      download.start(capture, server.client(), size, millis());
+    }
+
+    // POST /capture?enable=0|1 and POST /capture/clear
+    void handleCaptureControl() {
+      if (!capture.ready()) {
+        server.send(503, "text/plain", "SPIFFS not available");
+        return;
+      }
+      if (server.hasArg("enable")) {
+        bool on = server.arg("enable") == "1";
+        capture.setEnabled(on, "enable");
+        preferences.begin("vMixTally", false);
+        preferences.putBool("capture", on);
+        preferences.end();
+      }
+      char buf[96];
+      snprintf(buf, sizeof(buf), "capture:%s records:%u dropped:%u\n",
+        capture.isEnabled() ? "on" : "off", (unsigned)capture.records, (unsigned)capture.dropped);
+      server.send(200, "text/plain", buf);
+    }
+
     void handleCaptivePortal() {
     // TODO: compress
     static const char captivePortalTemplateHTML[] = R"===(
@@ -502,7 +1421,7 @@ public:
             margin-bottom: 8px;
             font-weight: bold;
         }
-        input {
+        input, select {
             width: 100%;
             padding: 10px;
             margin-bottom: 15px;
@@ -534,6 +1453,13 @@ public:
         <h2>vMix Configuration</h2>
         <label for="vmix-ip">IP Address</label>
         <input type="text" id="vmix-ip" name="ip" placeholder="Enter IP address" value="{{vmix_ip}}" required>
+        <label for="vmix-ip2">Backup IP Address</label>
+        <input type="text" id="vmix-ip2" name="ip2" placeholder="Optional" value="{{vmix_ip2}}">
+        <label for="vmix-policy">Backup Policy</label>
+        <select id="vmix-policy" name="policy">
+            <option value="failover">Failover</option>
+            <option value="merge" {{#merge}}selected{{/merge}}>Merge</option>
+        </select>
 
         <h2>Wi-Fi Configuration</h2>
         <label for="wifi-ssid">SSID</label>
@@ -550,6 +1476,8 @@ public:
       preferences.begin("vMixTally", true);
       JsonDocument data;
       data["vmix_ip"] = preferences.getString("vmix_ip");
+      data["vmix_ip2"] = preferences.getString("vmix_ip2");
+      data["merge"] = preferences.getUChar("vmix_policy", 0) == 1;
       data["wifi_ssid"] = preferences.getString("wifi_ssid");
       data["wifi_password"] = preferences.getString("wifi_pass");
       preferences.end();
@@ -558,20 +1486,48 @@ public:
     }
 
     virtual void enter() override {
+        preferences.begin("vMixTally", false);
+        health.reboots = preferences.getUInt("reboots", 0);
+        health.watchdog_resets = preferences.getUInt("wdt_resets", 0);
+        if (esp_reset_reason() == ESP_RST_TASK_WDT) {
+          health.watchdog_resets++;
+          preferences.putUInt("wdt_resets", health.watchdog_resets);
+        }
+        preferences.end();
+
+        Serial.printf("Glyph atlas: %u bytes in flash\n", (unsigned)atlas.size());
+
         // WIFI settings
         WiFi.mode(WIFI_MODE_APSTA);
+        // Modem sleep parks the radio between DTIM beacons (about 100 ms
+        // per beacon interval), which alone exceeds the failover threshold.
+        WiFi.setSleep(false);
         generateRandomString(ssid);
         generateRandomString(password);
         Serial.printf("Generated SSID:%s password:%s\n", ssid, password);
         
+        char WIFI_SSID[33] = "";
+        char WIFI_PASS[65] = "";
+        char VMIX_IP[64] = "";
         preferences.begin("vMixTally", true);
-        auto WIFI_SSID = preferences.getString("wifi_ssid");
-        auto WIFI_PASS = preferences.getString("wifi_pass");
-        auto VMIX_IP = preferences.getString("vmix_ip"); 
+        preferences.getString("wifi_ssid", WIFI_SSID, sizeof(WIFI_SSID));
+        preferences.getString("wifi_pass", WIFI_PASS, sizeof(WIFI_PASS));
+        preferences.getString("vmix_ip", VMIX_IP, sizeof(VMIX_IP));
+        bool CAPTURE = preferences.getBool("capture", false);
         preferences.end();
 
+        if (SPIFFS.begin(true)) {
+          char note[24];
+          snprintf(note, sizeof(note), "boot reset=%d", (int)esp_reset_reason());
+          capture.begin(SPIFFS);
+          capture.setEnabled(CAPTURE, note);
+        } else {
+          Serial.println("SPIFFS mount failed. vMix capture disabled");
+        }
+
+        loadLinks();
         Serial.printf("Connecting to vMix. IP: %s\n", VMIX_IP);
-        if (WIFI_SSID == "" || WIFI_PASS == "" || VMIX_IP == "") {
+        if (WIFI_SSID[0] == '\0' || WIFI_PASS[0] == '\0' || VMIX_IP[0] == '\0') {
           showSettingsQRCode();
           return;
         }
@@ -591,9 +1547,10 @@ public:
             sprite->println("WiFi AP configuration failed");
             return;
         };
-        sprite->printf("IP: %s\n", local_IP.toString());
+        sprite->printf("IP: %u.%u.%u.%u\n", local_IP[0], local_IP[1], local_IP[2], local_IP[3]);
 
-        Serial.printf("Starting DNS server. IP:%s Port:%d\n", WiFi.softAPIP().toString(), 53);
+        auto ap_ip = WiFi.softAPIP();
+        Serial.printf("Starting DNS server. IP:%u.%u.%u.%u Port:%d\n", ap_ip[0], ap_ip[1], ap_ip[2], ap_ip[3], 53);
         if (!dnsServer.start(53, "*", WiFi.softAPIP())) {
           sprite->println("failed to start DNS Server");
           return;
@@ -637,13 +1594,63 @@ public:
 
         // APIs...
         server.on("/settings", HTTP_POST, [&]() {
+          unsigned long new_failover_ms = 0;
+          if (server.hasArg("failover_ms") && !parseFailoverMs(server.arg("failover_ms").c_str(), new_failover_ms)) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "failover_ms must be 0 (auto) or %lu..%lu", FAILOVER_MIN_MS, FAILOVER_MAX_MS);
+            server.send(400, "text/plain", msg);
+            return;
+          }
           preferences.begin("vMixTally", false);
           preferences.putString("vmix_ip", server.arg("ip"));
+          if (server.hasArg("ip2")) {
+            preferences.putString("vmix_ip2", server.arg("ip2"));
+          }
+          if (server.hasArg("policy")) {
+            preferences.putUChar("vmix_policy", server.arg("policy") == "merge" ? 1 : 0);
+          }
+          if (server.hasArg("failover_ms")) {
+            preferences.putUInt("failover_ms", new_failover_ms);
+          }
           preferences.putString("wifi_ssid", server.arg("ssid"));
           preferences.putString("wifi_pass", server.arg("password"));
           preferences.end();
           server.send(200, "text/plain", "Success");
         });
+        server.on("/health", HTTP_GET, [&]() {
+          sendJson(json_buf, health.toJson(json_buf, sizeof(json_buf), millis()));
+        });
+        server.on("/status", HTTP_GET, [&]() {
+          sendJson(json_buf, statusToJson(json_buf, sizeof(json_buf), millis()));
+        });
+        server.on("/events", HTTP_GET, [&]() {
+          switch (events.accept(server.client())) {
+            case EventStream::ACCEPTED:
+              publishStatus(millis());
+              break;
+            case EventStream::REFUSED:
+              server.send(503, "text/plain", "too many event clients");
+              break;
+            case EventStream::FAILED:
+              // nothing to answer on a broken socket; WebServer closes it
+              break;
+          }
+        });
+        server.on("/vmix", HTTP_GET, [&]() {
+          sendJson(json_buf, linksToJson(json_buf, sizeof(json_buf), millis()));
+        });
+        server.on("/capture", HTTP_GET, [&]() {
+          handleCaptureDownload();
+        });
+        server.on("/capture", HTTP_POST, [&]() {
+          handleCaptureControl();
+        });
+        server.on("/capture/clear", HTTP_POST, [&]() {
+          if (capture.ready()) {
+            capture.clear();
+          }
+          server.send(200, "text/plain", "Success");
+        });
         server.begin();
 
         sprite->fillScreen(TFT_BLACK);
@@ -656,6 +1663,7 @@ public:
 
         Serial.println("STARTING...");
         while (!connectToWifi()) {
+          arena.reset();
           showSettingsQRCode();
         }
         if (!connectTovMix()) {
@@ -665,24 +1673,55 @@ public:
         }
         Serial.println("Initialization complete. Showing TALLY screen");
         showTallyScreen();
+
+        health.begin(millis());
+        startWatchdog();
+        engine_ready = true;
     }
 
     virtual void update() override {
+      unsigned long now = millis();
+      uint32_t loop_start = micros();
       bool shouldPushSprite = false;
+      arena.reset();
+      feedWatchdog();
       // update buttons
       btnA.update();
       btnB.update();
       btnC.update();
 
+      uint32_t t = micros();
       server.handleClient();
+      download.poll(now);
+      health.timed(HealthMonitor::HTTP, micros() - t);
       // handle WIFI server/client connection
       // TODO: Task
-      if(client.available()) {
-        String data = client.readStringUntil('\r\n');
-        handleData(data);
-      }
+      t = micros();
+      pollvMix(now);
+      health.timed(HealthMonitor::VMIX, micros() - t);
 
+      t = micros();
       dnsServer.processNextRequest();
+      health.timed(HealthMonitor::DNS, micros() - t);
+
+      capture.poll(now);
+
+      if (now - last_heap_log >= HEAP_LOG_INTERVAL_MS) {
+        last_heap_log = now;
+        logHeap();
+      }
+
+      checkHealth(now);
+      // Keep the loop's now: a stall after the drain above (a long log
+      // line, a SPIFFS flush) must not count as the links being silent.
+      // Stamps newer than now are read as age 0, see VmixLink::silence().
+      arbitrate(now);
+
+      if (now - last_status_push >= STATUS_INTERVAL_MS) {
+        publishStatus(now);
+      }
+
+      t = micros();
 
       switch(currentState) {
         case Screen::TALLY:
@@ -721,7 +1760,7 @@ public:
             shouldPushSprite = true;
           }
 
-          return;
+          break;
         case Screen::AP:
           if (btnA.isClick()) {
             showTallyScreen();
@@ -734,7 +1773,22 @@ public:
             showTallyScreen();
             shouldPushSprite = true;
           }
+
+          if (btnC.isClick()) {
+            showHealthScreen();
+            shouldPushSprite = true;
+          }
           
+          break;
+        case Screen::HEALTH:
+          if (btnA.isClick()) {
+            showTallyScreen();
+            shouldPushSprite = true;
+          } else if (now - last_health_draw >= 1000) {
+            showHealthScreen();
+            shouldPushSprite = true;
+          }
+
           break;
         case Screen::TALLY_SET:
           if (btnA.isClick()) {
@@ -765,6 +1819,8 @@ public:
       if(shouldPushSprite) {
         sprite->pushSprite(0, 0);
       }
+      health.timed(HealthMonitor::RENDER, micros() - t);
+      health.loopTime(micros() - loop_start);
     }
 };
 
@@ -0,0 +1,49 @@
+#pragma once
+
+// Host stand-in for the ESP32 WiFiClient, over a real socket, for the
+// native tests. Like the real one, copies share the socket, which is closed
+// when the last copy lets go of it.
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+
+class WiFiClient {
+  struct Handle {
+    int fd;
+    explicit Handle(int fd) : fd(fd) {}
+    ~Handle() { close(fd); }
+  };
+  std::shared_ptr<Handle> handle;
+
+public:
+  WiFiClient() {}
+  explicit WiFiClient(int fd) : handle(std::make_shared<Handle>(fd)) {}
+
+  int fd() const { return handle ? handle->fd : -1; }
+
+  uint8_t connected() {
+    if (!handle) {
+      return 0;
+    }
+    char c;
+    int n = recv(handle->fd, &c, 1, MSG_DONTWAIT | MSG_PEEK);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+  }
+
+  size_t write(const uint8_t* buf, size_t size) {
+    if (!handle) {
+      return 0;
+    }
+    ssize_t n = send(handle->fd, buf, size, MSG_NOSIGNAL);
+    return n < 0 ? 0 : (size_t)n;
+  }
+
+  void setNoDelay(bool) {}
+
+  void stop() { handle.reset(); }
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host stand-in for lwIP's BSD socket API, for the native tests.
+
+#include <sys/socket.h>
@@ -0,0 +1,176 @@
+// The /events stream on the host, over real sockets.
+//
+//   pio test -e native -f test_event_stream
+//
+// Every client is one end of a socketpair handed to EventStream the way
+// the /events handler does; the test reads the other end like a browser.
+// Clients that keep reading must get every event in order, while a client
+// that stops reading is dropped without holding up publish().
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <signal.h>
+#include <string>
+
+#include "event_stream.h"
+
+// The browser's end of one client.
+struct Peer {
+  int fd = -1;
+  std::string received;
+
+  // Connect a new client; returns the surface's end for accept().
+  WiFiClient open(int sndbuf = 0) {
+    int sv[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    if (sndbuf) {
+      setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+      setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &sndbuf, sizeof(sndbuf));
+    }
+    fd = sv[1];
+    return WiFiClient(sv[0]);
+  }
+
+  void drain() {
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+      received.append(buf, n);
+    }
+  }
+
+  // The data lines received so far must be 0, 1, 2, ... count - 1.
+  void expectEvents(int count) {
+    size_t pos = 0;
+    for (int i = 0; i < count; i++) {
+      char expect[48];
+      snprintf(expect, sizeof(expect), "event: status\ndata: {\"n\":%d}\n\n", i);
+      size_t at = received.find(expect, pos);
+      TEST_ASSERT_TRUE_MESSAGE(at != std::string::npos, expect);
+      pos = at + strlen(expect);
+    }
+    TEST_ASSERT_TRUE(received.find("data: ", pos) == std::string::npos);
+  }
+
+  void close() {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+  ~Peer() { close(); }
+};
+
+static void publish(EventStream& events, int n) {
+  char data[32];
+  int len = snprintf(data, sizeof(data), "{\"n\":%d}", n);
+  events.publish("status", data, len);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_sustained_clients_get_every_event(void) {
+  const int EVENTS = 20000;
+  EventStream events;
+  Peer peers[EventStream::MAX_CLIENTS];
+  for (auto& p : peers) {
+    TEST_ASSERT_EQUAL(EventStream::ACCEPTED, events.accept(p.open()));
+  }
+  for (int i = 0; i < EVENTS; i++) {
+    publish(events, i);
+    for (auto& p : peers) {
+      p.drain();
+    }
+  }
+  for (auto& p : peers) {
+    TEST_ASSERT_TRUE(p.received.compare(0, 17, "HTTP/1.1 200 OK\r\n") == 0);
+    p.expectEvents(EVENTS);
+  }
+  TEST_ASSERT_EQUAL_UINT32(EVENTS * EventStream::MAX_CLIENTS, events.sent);
+  TEST_ASSERT_EQUAL_UINT32(0, events.dropped);
+  TEST_ASSERT_EQUAL_UINT32(0, events.closed);
+}
+
+void test_slow_client_is_dropped_without_blocking(void) {
+  const int EVENTS = 5000;
+  EventStream events;
+  Peer reader;
+  Peer slow;
+  TEST_ASSERT_EQUAL(EventStream::ACCEPTED, events.accept(reader.open()));
+  TEST_ASSERT_EQUAL(EventStream::ACCEPTED, events.accept(slow.open(4096)));
+
+  double worst_ms = 0;
+  for (int i = 0; i < EVENTS; i++) {
+    auto start = std::chrono::steady_clock::now();
+    publish(events, i);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (ms > worst_ms) {
+      worst_ms = ms;
+    }
+    reader.drain();
+  }
+  char msg[64];
+  snprintf(msg, sizeof(msg), "slowest publish %.3f ms", worst_ms);
+  TEST_MESSAGE(msg);
+
+  TEST_ASSERT_EQUAL_UINT32(1, events.dropped);
+  TEST_ASSERT_EQUAL_UINT32(1, events.clientCount());
+  TEST_ASSERT_TRUE(worst_ms < 50);
+  reader.expectEvents(EVENTS);
+
+  // the slow client got whole frames up to where it was cut off
+  slow.drain();
+  size_t last = slow.received.rfind("\n\n");
+  TEST_ASSERT_EQUAL_size_t(slow.received.size(), last + 2);
+}
+
+void test_client_over_limit_is_refused(void) {
+  EventStream events;
+  Peer peers[EventStream::MAX_CLIENTS + 1];
+  for (size_t i = 0; i < EventStream::MAX_CLIENTS; i++) {
+    TEST_ASSERT_EQUAL(EventStream::ACCEPTED, events.accept(peers[i].open()));
+  }
+  WiFiClient extra = peers[EventStream::MAX_CLIENTS].open();
+  TEST_ASSERT_EQUAL(EventStream::REFUSED, events.accept(extra));
+  TEST_ASSERT_EQUAL_UINT32(1, events.refused);
+
+  // nothing was sent on it, so the handler can still answer 503
+  peers[EventStream::MAX_CLIENTS].drain();
+  TEST_ASSERT_TRUE(peers[EventStream::MAX_CLIENTS].received.empty());
+  const char busy[] = "HTTP/1.1 503";
+  TEST_ASSERT_EQUAL_size_t(sizeof(busy) - 1, extra.write((const uint8_t*)busy, sizeof(busy) - 1));
+}
+
+void test_broken_client_fails_and_frees_its_slot(void) {
+  EventStream events;
+  Peer gone;
+  WiFiClient client = gone.open();
+  gone.close();
+  TEST_ASSERT_EQUAL(EventStream::FAILED, events.accept(client));
+  TEST_ASSERT_EQUAL_UINT32(1, events.closed);
+  TEST_ASSERT_EQUAL_UINT32(0, events.refused);
+  TEST_ASSERT_EQUAL_UINT32(0, events.clientCount());
+
+  // a client that leaves later is noticed on the next publish
+  Peer leaving;
+  TEST_ASSERT_EQUAL(EventStream::ACCEPTED, events.accept(leaving.open()));
+  leaving.close();
+  publish(events, 0);
+  TEST_ASSERT_EQUAL_UINT32(2, events.closed);
+  TEST_ASSERT_EQUAL_UINT32(0, events.clientCount());
+}
+
+int main(void) {
+  // the surface's lwIP has no SIGPIPE; a write to a closed peer must fail
+  signal(SIGPIPE, SIG_IGN);
+  UNITY_BEGIN();
+  RUN_TEST(test_sustained_clients_get_every_event);
+  RUN_TEST(test_slow_client_is_dropped_without_blocking);
+  RUN_TEST(test_client_over_limit_is_refused);
+  RUN_TEST(test_broken_client_fails_and_frees_its_slot);
+  return UNITY_END();
+}
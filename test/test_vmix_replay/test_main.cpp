@@ -0,0 +1,326 @@
+// Replays vMix captures through the surface's parser on the host.
+//
+//   pio test -e native -f test_vmix_replay
+//
+// With VMIX_CAPTURE set to a file downloaded from GET /capture, that
+// capture is replayed too and its final tally per link is printed, which
+// turns a capture from a show into a regression case.
+
+#include <unity.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "capture_format.h"
+#include "vmix_protocol.h"
+
+// A capture built in memory, in the format CaptureLog writes.
+struct CaptureBuilder {
+  std::vector<uint8_t> bytes;
+
+  CaptureBuilder() {
+    bytes.resize(CaptureRecord::FILE_HEADER);
+    CaptureRecord::fileHeader(bytes.data());
+  }
+
+  void add(uint32_t ms, uint8_t source, const char* line) {
+    size_t len = strlen(line);
+    size_t pos = bytes.size();
+    bytes.resize(pos + CaptureRecord::HEADER + len);
+    CaptureRecord::encode(bytes.data() + pos, ms, source, line, len);
+  }
+};
+
+// One vMix link's VmixReceiver, fed the way VmixLink::poll() feeds it:
+// byte by byte with the CR/LF the capture stripped. A truncated record is
+// fed one byte longer, so it is discarded again like the original.
+struct Link {
+  VmixReceiver receiver;
+  uint32_t lines = 0;
+  uint32_t changes = 0;
+  uint32_t recorded = 0;  // lines the surface would capture again
+  uint32_t truncated = 0; // of those, flagged TRUNCATED
+
+  const VmixState& state() const { return receiver.state; }
+
+  void feed(const uint8_t* data, size_t len, bool cut) {
+    for (size_t i = 0; i < len; i++) {
+      push((char)data[i]);
+    }
+    if (cut) {
+      push('~');
+    }
+    push('\r');
+    push('\n');
+  }
+
+  void push(char c) {
+    receiver.push(c,
+      [this](const char*, size_t, bool complete) {
+        recorded++;
+        if (!complete) {
+          truncated++;
+        }
+      },
+      [this](VmixState::Kind, bool changed, const char*, size_t) {
+        lines++;
+        if (changed) {
+          changes++;
+        }
+      });
+  }
+};
+
+struct Replay {
+  Link links[2];
+  uint32_t records = 0;
+  uint32_t sessions = 0;
+
+  // Returns false when data is not a capture or is cut off mid-record.
+  bool run(const uint8_t* data, size_t len) {
+    if (!CaptureRecord::isFileHeader(data, len)) {
+      return false;
+    }
+    CaptureRecord r;
+    for (size_t pos = CaptureRecord::FILE_HEADER; pos < len;) {
+      size_t n = r.decode(data + pos, len - pos);
+      if (n == 0) {
+        return false;
+      }
+      pos += n;
+      records++;
+      if (r.source == CaptureRecord::SESSION) {
+        // the surface restarted: it reconnects with empty state
+        sessions++;
+        for (auto& link : links) {
+          link.receiver.rx.reset();
+          link.receiver.state.reset();
+        }
+        continue;
+      }
+      uint8_t link = r.source & ~CaptureRecord::TRUNCATED;
+      if (link < 2) {
+        links[link].feed(r.data, r.len, r.source & CaptureRecord::TRUNCATED);
+      }
+    }
+    return true;
+  }
+
+  bool run(const CaptureBuilder& capture) {
+    return run(capture.bytes.data(), capture.bytes.size());
+  }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_tally_follows_capture(void) {
+  CaptureBuilder capture;
+  capture.add(10, CaptureRecord::SESSION, "boot reset=1");
+  capture.add(500, 0, "SUBSCRIBE OK TALLY");
+  capture.add(510, 0, "TALLY OK 0120");
+  Replay replay;
+  TEST_ASSERT_TRUE(replay.run(capture));
+  const VmixState& s = replay.links[0].state();
+  TEST_ASSERT_EQUAL(Tally::SAFE, s.tally(1));
+  TEST_ASSERT_EQUAL(Tally::PGM, s.tally(2));
+  TEST_ASSERT_EQUAL(Tally::PRV, s.tally(3));
+  TEST_ASSERT_EQUAL(Tally::SAFE, s.tally(4));
+  TEST_ASSERT_EQUAL(Tally::UNKNOWN, s.tally(5));
+  TEST_ASSERT_EQUAL(Tally::UNKNOWN, s.tally(0));
+
+  capture.add(900, 0, "TALLY OK 2100");
+  capture.add(950, 0, "TALLY OK 2100");
+  Replay again;
+  TEST_ASSERT_TRUE(again.run(capture));
+  TEST_ASSERT_EQUAL(Tally::PRV, again.links[0].state().tally(1));
+  TEST_ASSERT_EQUAL(Tally::PGM, again.links[0].state().tally(2));
+  // the repeated TALLY OK is not a change
+  TEST_ASSERT_EQUAL_UINT32(2, again.links[0].changes);
+}
+
+void test_acts_sets_input(void) {
+  CaptureBuilder capture;
+  capture.add(100, 0, "ACTS OK Input 3 1");
+  capture.add(200, 0, "ACTS OK Input 5 0");
+  capture.add(300, 0, "ACTS OK InputPreview 4 1");
+  Replay replay;
+  TEST_ASSERT_TRUE(replay.run(capture));
+  const VmixState& s = replay.links[0].state();
+  TEST_ASSERT_EQUAL_INT(3, s.current_input);
+  TEST_ASSERT_EQUAL_STRING("InputPreview", s.acts_event);
+  TEST_ASSERT_EQUAL_INT(4, s.acts_input);
+
+  capture.add(400, 0, "ACTS OK Input 7.0 1");
+  Replay again;
+  TEST_ASSERT_TRUE(again.run(capture));
+  TEST_ASSERT_EQUAL_INT(7, again.links[0].state().current_input);
+}
+
+// Probe replies are told apart from tally updates, so they can be timed.
+void test_version_reply_is_not_tally(void) {
+  VmixState s;
+  bool changed;
+  TEST_ASSERT_EQUAL(VmixState::VERSION, s.handle("VERSION OK 27.0.0.49", 20, changed));
+  TEST_ASSERT_FALSE(changed);
+  TEST_ASSERT_EQUAL(VmixState::TALLY, s.handle("TALLY OK 1", 10, changed));
+  TEST_ASSERT_TRUE(changed);
+  TEST_ASSERT_EQUAL(VmixState::TALLY, s.handle("TALLY OK 1", 10, changed));
+  TEST_ASSERT_FALSE(changed);
+}
+
+void test_links_are_separate(void) {
+  CaptureBuilder capture;
+  capture.add(100, 0, "TALLY OK 10");
+  capture.add(101, 1, "TALLY OK 01");
+  Replay replay;
+  TEST_ASSERT_TRUE(replay.run(capture));
+  TEST_ASSERT_EQUAL(Tally::PGM, replay.links[0].state().tally(1));
+  TEST_ASSERT_EQUAL(Tally::SAFE, replay.links[1].state().tally(1));
+}
+
+void test_session_marker_resets_state(void) {
+  CaptureBuilder capture;
+  capture.add(60000, 0, "TALLY OK 1");
+  capture.add(61000, 0, "ACTS OK Input 2 1");
+  capture.add(5, CaptureRecord::SESSION, "boot reset=4");
+  capture.add(800, 0, "SUBSCRIBE OK TALLY");
+  Replay replay;
+  TEST_ASSERT_TRUE(replay.run(capture));
+  TEST_ASSERT_EQUAL_UINT32(1, replay.sessions);
+  TEST_ASSERT_EQUAL(Tally::UNKNOWN, replay.links[0].state().tally(1));
+  TEST_ASSERT_EQUAL_INT(0, replay.links[0].state().current_input);
+}
+
+void test_overlong_line_is_discarded(void) {
+  std::string line = "TALLY OK 2";
+  line.append(VMIX_MAX_LINE, '1');
+  CaptureBuilder capture;
+  capture.add(100, 0, "TALLY OK 2");
+  capture.add(200, 0, line.c_str());
+  // as the surface captures one: the start, flagged
+  line.resize(VMIX_MAX_LINE);
+  capture.add(250, 0 | CaptureRecord::TRUNCATED, line.c_str());
+  Replay replay;
+  TEST_ASSERT_TRUE(replay.run(capture));
+  TEST_ASSERT_EQUAL_UINT32(2, replay.links[0].receiver.rx.overlong);
+  // and would capture them again, flagged
+  TEST_ASSERT_EQUAL_UINT32(3, replay.links[0].recorded);
+  TEST_ASSERT_EQUAL_UINT32(2, replay.links[0].truncated);
+  // the cut line would have been a valid, different tally
+  TEST_ASSERT_EQUAL(Tally::PRV, replay.links[0].state().tally(1));
+
+  capture.add(300, 0, "TALLY OK 1");
+  Replay again;
+  TEST_ASSERT_TRUE(again.run(capture));
+  TEST_ASSERT_EQUAL(Tally::PGM, again.links[0].state().tally(1));
+}
+
+// The largest vMix show: every one of its inputs has a tally.
+void test_tally_for_every_input(void) {
+  std::string line = "TALLY OK ";
+  line.append(VMIX_MAX_INPUTS, '0');
+  line[9 + 239] = '1';
+  line[9 + VMIX_MAX_INPUTS - 1] = '2';
+  CaptureBuilder capture;
+  capture.add(100, 0, line.c_str());
+  Replay replay;
+  TEST_ASSERT_TRUE(replay.run(capture));
+  const VmixState& s = replay.links[0].state();
+  TEST_ASSERT_EQUAL_UINT32(0, replay.links[0].receiver.rx.overlong);
+  TEST_ASSERT_EQUAL(Tally::PGM, s.tally(240));
+  TEST_ASSERT_EQUAL(Tally::SAFE, s.tally(241));
+  TEST_ASSERT_EQUAL(Tally::PRV, s.tally(VMIX_MAX_INPUTS));
+  TEST_ASSERT_EQUAL(Tally::UNKNOWN, s.tally(VMIX_MAX_INPUTS + 1));
+}
+
+void test_truncated_capture_is_reported(void) {
+  CaptureBuilder capture;
+  capture.add(100, 0, "TALLY OK 1");
+  capture.bytes.resize(capture.bytes.size() - 3);
+  Replay replay;
+  TEST_ASSERT_FALSE(replay.run(capture));
+
+  uint8_t old_version[CaptureRecord::FILE_HEADER] = {'V', 'M', 'X', 'C', 'A', 'P', 3, 0};
+  TEST_ASSERT_FALSE(replay.run(old_version, sizeof(old_version)));
+}
+
+// Max-speed replay of a synthetic show: 32 inputs, a cut every record.
+void test_replay_throughput(void) {
+  const int RECORDS = 200000;
+  CaptureBuilder capture;
+  char line[64];
+  for (int i = 0; i < RECORDS; i++) {
+    if (i % 10 == 9) {
+      snprintf(line, sizeof(line), "ACTS OK Input %d 1", i % 32 + 1);
+    } else {
+      snprintf(line, sizeof(line), "TALLY OK %032d", i % 7 ? 0 : 1);
+      line[9 + i % 32] = '1';
+      line[9 + (i + 1) % 32] = '2';
+    }
+    capture.add((uint32_t)i * 40, 0, line);
+  }
+
+  Replay replay;
+  auto start = std::chrono::steady_clock::now();
+  TEST_ASSERT_TRUE(replay.run(capture));
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  TEST_ASSERT_EQUAL_UINT32(RECORDS, replay.links[0].lines);
+  // last TALLY OK (record 199998): input 31 on program, 32 on preview;
+  // last ACTS (record 199999): input 32
+  TEST_ASSERT_EQUAL(Tally::PGM, replay.links[0].state().tally(31));
+  TEST_ASSERT_EQUAL(Tally::PRV, replay.links[0].state().tally(32));
+  TEST_ASSERT_EQUAL(Tally::SAFE, replay.links[0].state().tally(1));
+  TEST_ASSERT_EQUAL_INT(32, replay.links[0].state().current_input);
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%d lines in %.3f s, %.0f lines/s", RECORDS, secs, RECORDS / secs);
+  TEST_MESSAGE(msg);
+}
+
+// Replay a capture from a show, if one is given.
+void test_replay_capture_file(void) {
+  const char* path = getenv("VMIX_CAPTURE");
+  if (!path) {
+    TEST_IGNORE_MESSAGE("set VMIX_CAPTURE to a capture downloaded from GET /capture");
+  }
+  FILE* f = fopen(path, "rb");
+  TEST_ASSERT_TRUE_MESSAGE(f != nullptr, "cannot open VMIX_CAPTURE");
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(f);
+
+  Replay replay;
+  TEST_ASSERT_TRUE_MESSAGE(replay.run(data.data(), data.size()), "not a version 4 capture, or cut off");
+  char msg[160 + VMIX_MAX_LINE];
+  for (int i = 0; i < 2; i++) {
+    const VmixState& s = replay.links[i].state();
+    snprintf(msg, sizeof(msg), "link %d: %u lines, %u changes, %u overlong, input %d, tally %s",
+      i, (unsigned)replay.links[i].lines, (unsigned)replay.links[i].changes,
+      (unsigned)replay.links[i].receiver.rx.overlong, s.current_input, s.tally_states);
+    TEST_MESSAGE(msg);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_tally_follows_capture);
+  RUN_TEST(test_acts_sets_input);
+  RUN_TEST(test_version_reply_is_not_tally);
+  RUN_TEST(test_links_are_separate);
+  RUN_TEST(test_session_marker_resets_state);
+  RUN_TEST(test_overlong_line_is_discarded);
+  RUN_TEST(test_tally_for_every_input);
+  RUN_TEST(test_truncated_capture_is_reported);
+  RUN_TEST(test_replay_throughput);
+  RUN_TEST(test_replay_capture_file);
+  return UNITY_END();
+}
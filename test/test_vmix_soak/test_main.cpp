@@ -0,0 +1,146 @@
+// 24 h of vMix traffic through the surface's line path, on the host.
+//
+//   pio test -e native -f test_vmix_soak
+//
+// Every line goes the way it does on the device: byte by byte through
+// VmixReceiver (line reader and parser) into a CaptureBuffer, the code
+// VmixLink and CaptureLog run; only the SPIFFS write is left out, the
+// buffer is cleared where CaptureLog would write it to flash. operator new
+// is counted; the path must not allocate at all, so the count has to stay
+// flat for the whole simulated day.
+
+#include <unity.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "capture_format.h"
+#include "vmix_protocol.h"
+
+static unsigned long allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+static const uint32_t DAY_MS = 24UL * 60 * 60 * 1000;
+
+// One link's receive path, as on the device.
+struct Link {
+  VmixReceiver receiver;
+  CaptureBuffer capture;
+  uint32_t lines = 0;
+  uint32_t versions = 0;
+  uint32_t changes = 0;
+  uint32_t captured = 0;
+  uint32_t written = 0; // bytes CaptureLog would have written to flash
+
+  void receive(uint32_t ms, const char* line, size_t len) {
+    auto record = [&](const char* data, size_t n, bool complete) {
+      bool added = capture.add(ms, CaptureRecord::lineSource(0, complete), data, n, [&]() {
+        written += capture.len;
+        capture.clear();
+      });
+      if (added) {
+        captured++;
+      }
+    };
+    auto handled = [&](VmixState::Kind kind, bool changed, const char*, size_t) {
+      lines++;
+      if (kind == VmixState::VERSION) {
+        versions++;
+      }
+      if (changed) {
+        changes++;
+      }
+    };
+    for (size_t i = 0; i < len; i++) {
+      receiver.push(line[i], record, handled);
+    }
+    receiver.push('\r', record, handled);
+    receiver.push('\n', record, handled);
+  }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A busy show on two vMix: a TALLY OK and a VERSION OK probe reply every
+// 500 ms, a preview change every second and a cut with its ACTS every 2 s.
+void test_day_of_traffic_does_not_allocate(void) {
+  static Link links[2];
+  char line[128];
+  char states[33];
+
+  unsigned long before = allocations;
+  uint32_t step = 0;
+  for (uint32_t ms = 0; ms < DAY_MS; ms += 500, step++) {
+    // 32 inputs, program and preview walking through them
+    for (int i = 0; i < 32; i++) {
+      states[i] = '0';
+    }
+    states[32] = '\0';
+    uint32_t cut = step / 4;
+    states[cut % 32] = '1';
+    states[(cut + 1 + step % 4 / 2) % 32] = '2';
+
+    int n = snprintf(line, sizeof(line), "TALLY OK %s", states);
+    for (auto& link : links) {
+      link.receive(ms, line, n);
+      link.receive(ms, "VERSION OK 27.0.0.49", 20);
+    }
+    if (step % 4 == 0) {
+      n = snprintf(line, sizeof(line), "ACTS OK Input %u 1", (unsigned)(cut % 32 + 1));
+      for (auto& link : links) {
+        link.receive(ms, line, n);
+      }
+    }
+  }
+  unsigned long during = allocations - before;
+
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%u lines, %u changes, %u captured (%u bytes) per link, %lu allocations",
+    (unsigned)links[0].lines, (unsigned)links[0].changes, (unsigned)links[0].captured,
+    (unsigned)links[0].written, during);
+  TEST_MESSAGE(msg);
+
+  TEST_ASSERT_EQUAL_UINT32(0, during);
+  TEST_ASSERT_EQUAL_UINT32(24UL * 60 * 60 * 2 * 9 / 4, links[0].lines);
+  TEST_ASSERT_EQUAL_UINT32(24UL * 60 * 60 * 2, links[0].versions);
+  // every line is captured, as on the device
+  TEST_ASSERT_EQUAL_UINT32(links[0].lines, links[0].captured);
+  TEST_ASSERT_EQUAL_UINT32(0, links[0].receiver.rx.overlong);
+  TEST_ASSERT_EQUAL_UINT32(links[0].changes, links[1].changes);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_day_of_traffic_does_not_allocate);
+  return UNITY_END();
+}
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""Generate the tally label glyph atlas (glyph_atlas_data.h).
+
+Reads an Adafruit GFX font header (FreeSansBold24pt7b.h from M5GFX), scales
+the glyphs of CHARSET by SCALE, smooths them with a 3x3 tent filter into
+LEVELS coverage levels and writes them as const run-length encoded tables,
+so the atlas lives in flash and nothing is rendered at boot. See
+include/glyph_atlas.h for the encoding.
+
+PlatformIO runs this as a pre: extra script and writes the header to
+$BUILD_DIR/generated. It can also be run by hand to inspect the output:
+
+    python tools/gen_glyph_atlas.py path/to/FreeSansBold24pt7b.h -o glyph_atlas_data.h
+"""
+
+import argparse
+import glob
+import os
+import re
+import sys
+
+FONT = "FreeSansBold24pt7b"
+CHARSET = "SAFEPGMRV?0123456789"
+SCALE = 2
+# The tally sprite is 8-bit (RGB332); its 2-bit blue cannot show more.
+LEVELS = 4
+MAX_RUN = 64
+
+
+def parse_font(path):
+    """Return (bitmap bytes, {char: glyph tuple}) from a GFXfont header.
+
+    A glyph tuple is (bitmapOffset, width, height, xAdvance, xOffset, yOffset).
+    """
+    with open(path, encoding="utf-8", errors="replace") as f:
+        text = f.read()
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"//[^\n]*", "", text)
+
+    m = re.search(r"Bitmaps\s*\[\s*\]\s*(?:PROGMEM\s*)?=\s*\{(.*?)\}\s*;", text, re.S)
+    if not m:
+        raise ValueError("%s: no bitmap table" % path)
+    bitmap = bytes(int(v, 0) for v in re.findall(r"0x[0-9A-Fa-f]+|\d+", m.group(1)))
+
+    m = re.search(r"Glyphs\s*\[\s*\]\s*(?:PROGMEM\s*)?=\s*\{(.*?)\}\s*;", text, re.S)
+    if not m:
+        raise ValueError("%s: no glyph table" % path)
+    glyphs = [tuple(int(v) for v in g) for g in re.findall(
+        r"\{\s*(-?\d+)\s*,\s*(-?\d+)\s*,\s*(-?\d+)\s*,\s*(-?\d+)\s*,\s*(-?\d+)\s*,\s*(-?\d+)\s*\}",
+        m.group(1))]
+
+    m = re.search(r"GFXfont\s+\w+\s*(?:PROGMEM\s*)?=\s*\{[^;]*?,\s*(0x[0-9A-Fa-f]+|\d+)\s*,"
+                  r"\s*(0x[0-9A-Fa-f]+|\d+)\s*,\s*(\d+)\s*\}\s*;", text, re.S)
+    if not m:
+        raise ValueError("%s: no GFXfont definition" % path)
+    first, last = int(m.group(1), 0), int(m.group(2), 0)
+    if len(glyphs) != last - first + 1:
+        raise ValueError("%s: %d glyphs for 0x%02X..0x%02X" % (path, len(glyphs), first, last))
+    return bitmap, {chr(first + i): g for i, g in enumerate(glyphs)}
+
+
+def render(bitmap, glyph):
+    """Return (width, height, rows of levels) for one scaled, smoothed glyph."""
+    offset, gw, gh = glyph[0], glyph[1], glyph[2]
+
+    def src(x, y):
+        if x < 0 or y < 0 or x >= gw or y >= gh:
+            return 0
+        bit = y * gw + x
+        return 1 if bitmap[offset + (bit >> 3)] & (0x80 >> (bit & 7)) else 0
+
+    # scaled pixel, with a one pixel transparent border for the filter
+    def up(x, y):
+        if x < 1 or y < 1:
+            return 0
+        return src((x - 1) // SCALE, (y - 1) // SCALE)
+
+    w = gw * SCALE + 2
+    h = gh * SCALE + 2
+    rows = []
+    for y in range(h):
+        row = []
+        for x in range(w):
+            # 1 2 1 / 2 4 2 / 1 2 1 tent filter, sum 0..16
+            total = 0
+            for dy in (-1, 0, 1):
+                for dx in (-1, 0, 1):
+                    total += (1 if dx else 2) * (1 if dy else 2) * up(x + dx, y + dy)
+            row.append((total * (LEVELS - 1) + 8) // 16)
+        rows.append(row)
+    return w, h, rows
+
+
+def encode(rows):
+    """Run-length encode rows, one byte per run: (level << 6) | (run - 1)."""
+    out = bytearray()
+    for row in rows:
+        level, run = row[0], 0
+        for v in row:
+            if v == level and run < MAX_RUN:
+                run += 1
+                continue
+            out.append((level << 6) | (run - 1))
+            level, run = v, 1
+        out.append((level << 6) | (run - 1))
+    return out
+
+
+def generate(font_path):
+    bitmap, glyphs = parse_font(font_path)
+    entries = []
+    data = bytearray()
+    for c in CHARSET:
+        if c not in glyphs:
+            raise ValueError("%s: no glyph for %r" % (font_path, c))
+        g = glyphs[c]
+        w, h, rows = render(bitmap, g)
+        if w > 255 or h > 255:
+            raise ValueError("glyph %r too large: %dx%d" % (c, w, h))
+        rle = encode(rows)
+        entries.append((c, len(data), len(rle), w, h, g[3] * SCALE, g[4] * SCALE - 1, g[5] * SCALE - 1))
+        data += rle
+    if len(data) > 0xFFFF:
+        raise ValueError("atlas too large: %d bytes" % len(data))
+
+    lines = [
+        "// Generated by tools/gen_glyph_atlas.py from %s. Do not edit." % os.path.basename(font_path),
+        "#pragma once",
+        "",
+        "static const int GLYPH_ATLAS_LEVELS = %d;" % LEVELS,
+        "static const size_t GLYPH_ATLAS_COUNT = %d;" % len(entries),
+        "",
+        "static const uint8_t GLYPH_ATLAS_RLE[%d] = {" % len(data),
+    ]
+    for i in range(0, len(data), 16):
+        lines.append("  " + " ".join("0x%02X," % b for b in data[i:i + 16]))
+    lines += [
+        "};",
+        "",
+        "// c, offset, size, width, height, advance, xOffset, yOffset",
+        "static const GlyphAtlasGlyph GLYPH_ATLAS_GLYPHS[GLYPH_ATLAS_COUNT] = {",
+    ]
+    for c, off, size, w, h, adv, xo, yo in entries:
+        lines.append("  {'%s', %d, %d, %d, %d, %d, %d, %d}," % (c, off, size, w, h, adv, xo, yo))
+    lines += ["};", ""]
+    return "\n".join(lines), len(data)
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path, encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+def find_font(libdeps):
+    matches = glob.glob(os.path.join(libdeps, "**", FONT + ".h"), recursive=True)
+    if not matches:
+        raise FileNotFoundError("%s.h not found under %s (is M5GFX installed?)" % (FONT, libdeps))
+    return sorted(matches)[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("font", help="GFXfont header, e.g. %s.h" % FONT)
+    parser.add_argument("-o", "--output", default="glyph_atlas_data.h")
+    args = parser.parse_args()
+    text, size = generate(args.font)
+    write_if_changed(args.output, text)
+    print("%s: %d glyphs, %d bytes" % (args.output, len(CHARSET), size))
+    return 0
+
+
+def register(env):
+    """Generate the atlas before main.cpp is compiled.
+
+    Runs as a pre-action of the object rather than right away: on a clean
+    checkout the pre: script runs before lib_deps (and so M5GFX) are installed.
+    """
+    gen_dir = env.subst("$BUILD_DIR/generated")
+    output = os.path.join(gen_dir, "glyph_atlas_data.h")
+    libdeps = env.subst("$PROJECT_LIBDEPS_DIR/$PIOENV")
+    script = os.path.join(env.subst("$PROJECT_DIR"), "tools", "gen_glyph_atlas.py")
+    env.Append(CPPPATH=[gen_dir])
+
+    def build_atlas(target, source, env):
+        text, size = generate(find_font(libdeps))
+        write_if_changed(output, text)
+        print("Generated glyph atlas: %d glyphs, %d bytes" % (len(CHARSET), size))
+
+    obj = "$BUILD_DIR/src/main.cpp.o"
+    env.AddPreAction(obj, build_atlas)
+    env.Depends(obj, script)
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO's SCons
+    register(env)  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        sys.exit(main())
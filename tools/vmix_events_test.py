@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Soak a surface's /events stream against a stand-in vMix.
+
+Runs a stand-in vMix on this host, keeps several SSE clients on the
+surface's GET /events, toggles the tally of the surface's target between
+PGM and PRV, and checks that every client sees every change. Optionally
+adds a client that never reads, which the surface must drop without
+stalling the others.
+
+Point the surface's vMix IP at this host first (captive portal or POST
+/settings), then:
+
+    python tools/vmix_events_test.py http://192.168.4.22
+    python tools/vmix_events_test.py http://192.168.4.22 --slow --duration 600
+
+All --max-clients slots are filled (one of them by the slow client with
+--slow), so one more client must be refused.
+"""
+
+import argparse
+import json
+import socket
+import sys
+import threading
+import time
+import urllib.parse
+import urllib.request
+
+from vmix_replay import VmixStandIn
+
+
+def get_json(surface, path):
+    with urllib.request.urlopen(surface + path, timeout=2) as resp:
+        return json.load(resp)
+
+
+def open_events(surface, rcvbuf=None):
+    url = urllib.parse.urlparse(surface)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    if rcvbuf:
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, rcvbuf)
+    sock.connect((url.hostname, url.port or 80))
+    sock.sendall(b"GET /events HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n"
+                 % url.hostname.encode())
+    return sock
+
+
+class Reader(threading.Thread):
+    """Reads status events and times tally changes against the sender."""
+
+    def __init__(self, name, sock, changes):
+        super().__init__(daemon=True)
+        self.name = name
+        self.sock = sock
+        self.changes = changes
+        self.events = 0
+        self.seen = 0
+        self.latencies = []
+        self.error = None
+        self.last_tally = None
+
+    def run(self):
+        buf = b""
+        try:
+            while True:
+                chunk = self.sock.recv(4096)
+                if not chunk:
+                    self.error = "stream closed"
+                    return
+                buf += chunk
+                while b"\n" in buf:
+                    line, buf = buf.split(b"\n", 1)
+                    if line.startswith(b"HTTP/1.1 ") and not line.startswith(b"HTTP/1.1 200"):
+                        self.error = line.decode().strip()
+                        return
+                    if line.startswith(b"data: "):
+                        self._status(json.loads(line[6:]), time.monotonic())
+        except OSError as e:
+            self.error = str(e)
+
+    def _status(self, status, now):
+        self.events += 1
+        tally = status["tally"]
+        if tally == self.last_tally:
+            return
+        self.last_tally = tally
+        # latest change the sender made to this state
+        for sent_at, expected in reversed(self.changes):
+            if expected == tally:
+                self.seen += 1
+                self.latencies.append((now - sent_at) * 1000)
+                return
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("surface", help="surface base URL, e.g. http://192.168.4.22")
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8099, help="stand-in vMix port")
+    parser.add_argument("--max-clients", type=int, default=3,
+                        help="EventStream::MAX_CLIENTS on the surface")
+    parser.add_argument("--slow", action="store_true",
+                        help="add a client that never reads its stream")
+    parser.add_argument("--duration", type=float, default=60)
+    parser.add_argument("--interval", type=float, default=0.5,
+                        help="seconds between tally changes")
+    parser.add_argument("--max-ms", type=float, default=200,
+                        help="allowed p99 change-to-event latency")
+    args = parser.parse_args()
+    surface = args.surface.rstrip("/")
+
+    vmix = VmixStandIn(args.bind, args.port)
+    try:
+        print("waiting for the surface to subscribe...")
+        vmix.wait_for_client()
+        target = get_json(surface, "/status")["target"]
+        if target < 1:
+            print("surface has no tally target set")
+            return 1
+
+        changes = []
+        readers = []
+        for i in range(args.max_clients - (1 if args.slow else 0)):
+            reader = Reader("client%d" % (i + 1), open_events(surface), changes)
+            reader.start()
+            readers.append(reader)
+        slow = open_events(surface, rcvbuf=1024) if args.slow else None
+
+        # one over the limit must be refused, not queued
+        extra = open_events(surface)
+        extra.settimeout(2)
+        refused = extra.recv(64).startswith(b"HTTP/1.1 503")
+        extra.close()
+
+        end = time.monotonic() + args.duration
+        state = "1"
+        while time.monotonic() < end:
+            state = "2" if state == "1" else "1"
+            states = "0" * (target - 1) + state
+            changes.append((time.monotonic(), "PGM" if state == "1" else "PRV"))
+            vmix.broadcast(b"TALLY OK " + states.encode())
+            time.sleep(args.interval)
+        time.sleep(1)
+
+        status = get_json(surface, "/status")
+        ok = True
+        for reader in readers:
+            missed = len(changes) - reader.seen
+            p50 = percentile(reader.latencies, 50)
+            p99 = percentile(reader.latencies, 99)
+            good = reader.error is None and missed == 0 and p99 <= args.max_ms
+            ok = ok and good
+            print("%s %s: %d events, %d/%d changes, p50 %.0f ms, p99 %.0f ms%s"
+                  % ("PASS" if good else "FAIL", reader.name, reader.events, reader.seen,
+                     len(changes), p50, p99, ", " + reader.error if reader.error else ""))
+        print("%s over-limit client refused" % ("PASS" if refused else "FAIL"))
+        ok = ok and refused
+        if slow:
+            dropped = status["events"]["dropped"] > 0
+            print("%s slow client dropped (%d)" % ("PASS" if dropped else "FAIL",
+                                                   status["events"]["dropped"]))
+            ok = ok and dropped
+            slow.close()
+        print("surface loop max %d us, overruns %d, heap min free %d"
+              % (status["loop"]["max_us"], status["loop"]["overruns"], status["heap"]["min_free"]))
+        return 0 if ok else 1
+    except KeyboardInterrupt:
+        return 1
+    finally:
+        vmix.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Measure primary -> backup vMix failover on a surface.
+
+Runs two stand-in vMix servers on this host, waits until the surface is
+subscribed to both, then kills (or hangs) the primary and polls the
+surface's GET /vmix until it reports the secondary as active.
+
+Configure the surface first (captive portal or POST /settings) with
+    vMix IP:        <this host>:8099
+    Backup IP:      <this host>:8100
+    Backup Policy:  failover
+
+    python tools/vmix_failover_test.py http://192.168.4.22
+    python tools/vmix_failover_test.py http://192.168.4.22 --hang --runs 10
+
+Two timings are reported per run: the surface's own last_failover_ms (time
+from the last line heard on the primary to the switch), and the host
+observed time from kill to /vmix showing the secondary, which includes the
+HTTP polling interval. The run passes when the surface's figure is within
+--max-ms. The primary's silence limit, derived on the surface from its
+measured loop time and probe round trip unless failover_ms is set, is
+printed before each run.
+"""
+
+import argparse
+import json
+import sys
+import time
+import urllib.request
+
+from vmix_replay import VmixStandIn
+
+
+def get_links(surface):
+    with urllib.request.urlopen(surface + "/vmix", timeout=2) as resp:
+        return json.load(resp)
+
+
+def wait_for(predicate, timeout, interval=0.01):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        try:
+            state = predicate()
+            if state:
+                return state
+        except OSError:
+            pass
+        time.sleep(interval)
+    return None
+
+
+def both_alive(surface):
+    state = get_links(surface)
+    links = state["links"]
+    if state["active"] == "primary" and all(l["alive"] for l in links):
+        return state
+    return None
+
+
+def active_is(surface, label):
+    state = get_links(surface)
+    return state if state["active"] == label else None
+
+
+def run_once(surface, primary, secondary, hang, max_ms):
+    # both instances agree: input 1 on program
+    for server in (primary, secondary):
+        server.broadcast(b"TALLY OK 1")
+    ready = wait_for(lambda: both_alive(surface), timeout=15)
+    if not ready:
+        print("surface never reached primary active with both links alive")
+        return False
+    print("primary silence limit %d ms (rtt peak %d us, probe every %d ms)"
+          % (ready["links"][0]["limit_ms"], ready["links"][0]["rtt_peak_us"], ready["probe_ms"]))
+
+    start = time.monotonic()
+    if hang:
+        primary.mute()
+    else:
+        # close the port too: a vMix that is gone refuses the reconnect
+        primary.kill(listen=False)
+    state = wait_for(lambda: active_is(surface, "secondary"), timeout=10)
+    observed_ms = (time.monotonic() - start) * 1000
+    if hang:
+        primary.mute(False)
+    else:
+        primary.listen()
+    if not state:
+        print("no failover within 10 s")
+        return False
+
+    device_ms = state["last_failover_ms"]
+    ok = device_ms <= max_ms
+    print("%s device %d ms, host observed %.0f ms (failovers: %d)"
+          % ("PASS" if ok else "FAIL", device_ms, observed_ms, state["failovers"]))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("surface", help="surface base URL, e.g. http://192.168.4.22")
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--primary-port", type=int, default=8099)
+    parser.add_argument("--secondary-port", type=int, default=8100)
+    parser.add_argument("--hang", action="store_true",
+                        help="stop answering instead of closing the connection")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--max-ms", type=int, default=100)
+    args = parser.parse_args()
+    surface = args.surface.rstrip("/")
+
+    primary = VmixStandIn(args.bind, args.primary_port, tally="1")
+    secondary = VmixStandIn(args.bind, args.secondary_port, tally="1")
+    passed = 0
+    try:
+        print("waiting for the surface to subscribe to both stand-ins...")
+        primary.wait_for_client()
+        secondary.wait_for_client()
+        for run in range(args.runs):
+            print("run %d: " % (run + 1), end="", flush=True)
+            if run_once(surface, primary, secondary, args.hang, args.max_ms):
+                passed += 1
+            # the surface reconnects the primary in the background and fails
+            # back once it has sent its tally
+            primary.wait_for_client(timeout=15)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        primary.close()
+        secondary.close()
+
+    print("%d/%d runs within %d ms" % (passed, args.runs, args.max_ms))
+    return 0 if passed == args.runs else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
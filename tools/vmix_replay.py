@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+"""Replay a vMix capture downloaded from a surface (GET /capture).
+
+The surface is pointed at this host as its vMix IP. The replayer listens on
+the vMix TCP API port, answers SUBSCRIBE and feeds the captured lines to the
+connected surface, either at the recorded pace or as fast as possible.
+
+    python tools/vmix_replay.py dump vmix-capture.bin
+    python tools/vmix_replay.py serve vmix-capture.bin --speed 1
+    python tools/vmix_replay.py serve vmix-capture.bin --speed 0 --loops 10
+    python tools/vmix_replay.py serve vmix-capture.bin --source 1
+
+--speed 0 replays at max speed and reports throughput, which makes it a
+benchmark with real production traffic.
+
+Capture format (see include/capture.h):
+    "VMXCAP" u8 version u8 reserved
+    version 1: u32 millis (LE) | u16 length (LE) | length bytes
+    version 2+: u32 millis (LE) | u16 length (LE) | u8 source | length bytes
+source is the vMix link the line came from (0 primary, 1 secondary). From
+version 3, source 255 is a session marker written whenever the surface
+starts recording, e.g. after a reboot; millis restarts there, so replay
+and dump restart their timebase at every marker. From version 4 every line
+the surface received is kept, and source has bit 7 (TRUNCATED) set for a
+line the surface discarded as too long; only its start is stored, and
+replay sends it one byte longer so the surface discards it again.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+MAGIC = b"VMXCAP"
+VERSIONS = (1, 2, 3, 4)
+VMIX_PORT = 8099
+SESSION = 0xFF
+TRUNCATED = 0x80
+RECORDS = {1: struct.Struct("<IH"), 2: struct.Struct("<IHB"), 3: struct.Struct("<IHB"),
+           4: struct.Struct("<IHB")}
+
+
+def link_of(source):
+    """The vMix link of a line record, without the TRUNCATED flag."""
+    return source & ~TRUNCATED
+
+
+def read_capture(path):
+    """Return the capture as a list of (millis, source, line) tuples.
+
+    Session markers are kept, with source SESSION.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < 8 or data[:6] != MAGIC:
+        raise ValueError("%s: not a vMix capture" % path)
+    version = data[6]
+    if version not in VERSIONS:
+        raise ValueError("%s: unsupported capture version %d" % (path, version))
+    record = RECORDS[version]
+
+    frames = []
+    pos = 8
+    while pos + record.size <= len(data):
+        fields = record.unpack_from(data, pos)
+        ms, length = fields[0], fields[1]
+        source = fields[2] if version >= 2 else 0
+        pos += record.size
+        if pos + length > len(data):
+            print("warning: truncated record at offset %d" % pos, file=sys.stderr)
+            break
+        frames.append((ms, source, data[pos:pos + length]))
+        pos += length
+    return frames
+
+
+class VmixStandIn:
+    """Minimal stand-in for the vMix TCP API.
+
+    Accepts connections, replies to SUBSCRIBE/TALLY/VERSION commands and lets
+    the caller push raw lines to every subscribed client. mute() simulates a hung
+    vMix (connections stay open, nothing is sent); kill() closes every
+    connection like a crashed vMix, and kill(listen=False) also closes the
+    port, like a vMix that has quit, until listen() is called again.
+    """
+
+    def __init__(self, host="0.0.0.0", port=VMIX_PORT, tally="0"):
+        self.host = host
+        self.port = port
+        self.tally = tally
+        self.muted = False
+        self.clients = []
+        self.lock = threading.Lock()
+        self.sock = None
+        self.running = True
+        self.listen()
+
+    def listen(self):
+        """Accept connections on the port (again, after kill(listen=False))."""
+        if self.sock is not None:
+            return
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        sock.bind((self.host, self.port))
+        sock.listen(4)
+        self.sock = sock
+        threading.Thread(target=self._accept, args=(sock,), daemon=True).start()
+
+    def _close_listener(self):
+        sock, self.sock = self.sock, None
+        if sock is None:
+            return
+        try:
+            # wakes the accept() blocked in _accept
+            sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        sock.close()
+
+    def _accept(self, sock):
+        while self.running:
+            try:
+                conn, addr = sock.accept()
+            except OSError:
+                return
+            conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            print("surface connected from %s:%d" % addr, file=sys.stderr)
+            threading.Thread(target=self._serve, args=(conn,), daemon=True).start()
+
+    def _serve(self, conn):
+        buf = b""
+        while self.running:
+            try:
+                chunk = conn.recv(1024)
+            except OSError:
+                break
+            if not chunk:
+                break
+            buf += chunk
+            while b"\n" in buf:
+                line, buf = buf.split(b"\n", 1)
+                self._command(conn, line.strip().decode("ascii", "replace"))
+        self._drop(conn)
+
+    def _command(self, conn, cmd):
+        if cmd.startswith("SUBSCRIBE"):
+            what = cmd.split(" ", 1)[1] if " " in cmd else ""
+            self._send(conn, b"SUBSCRIBE OK " + what.encode() + b"\r\n")
+            with self.lock:
+                if conn not in self.clients:
+                    self.clients.append(conn)
+        elif cmd == "TALLY":
+            self._send(conn, b"TALLY OK " + self.tally.encode() + b"\r\n")
+        elif cmd == "VERSION":
+            self._send(conn, b"VERSION OK 27.0.0.49\r\n")
+
+    def _send(self, conn, data):
+        if self.muted:
+            return True
+        try:
+            conn.sendall(data)
+            return True
+        except OSError:
+            self._drop(conn)
+            return False
+
+    def _drop(self, conn):
+        with self.lock:
+            if conn in self.clients:
+                self.clients.remove(conn)
+        try:
+            conn.close()
+        except OSError:
+            pass
+
+    def wait_for_client(self, timeout=None):
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while not self.clients:
+            if deadline is not None and time.monotonic() > deadline:
+                return False
+            time.sleep(0.05)
+        return True
+
+    def broadcast(self, line):
+        """Send one line (bytes, without CR/LF) to every subscribed client."""
+        if line.startswith(b"TALLY OK "):
+            self.tally = line[9:].decode("ascii", "replace")
+        with self.lock:
+            clients = list(self.clients)
+        for conn in clients:
+            self._send(conn, line + b"\r\n")
+        return len(clients)
+
+    def mute(self, muted=True):
+        self.muted = muted
+
+    def kill(self, listen=True):
+        """Close every client connection; with listen=False, the port too."""
+        if not listen:
+            self._close_listener()
+        with self.lock:
+            clients, self.clients = self.clients, []
+        for conn in clients:
+            try:
+                conn.shutdown(socket.SHUT_RDWR)
+                conn.close()
+            except OSError:
+                pass
+
+    def close(self):
+        self.running = False
+        self._close_listener()
+        with self.lock:
+            clients, self.clients = self.clients, []
+        for conn in clients:
+            try:
+                conn.close()
+            except OSError:
+                pass
+
+
+def replay(server, frames, speed):
+    """Push frames to the connected surface. Returns (lines, bytes, seconds)."""
+    lines = [f for f in frames if f[1] != SESSION]
+    if not lines:
+        return 0, 0, 0.0
+    start = base = time.monotonic()
+    first_ms = None
+    sent_bytes = 0
+    for ms, source, line in frames:
+        if source == SESSION:
+            # the surface restarted recording; its millis start over
+            first_ms = None
+            continue
+        if first_ms is None:
+            first_ms = ms
+            base = time.monotonic()
+        if speed > 0:
+            due = base + ((ms - first_ms) & 0xFFFFFFFF) / 1000.0 / speed
+            delay = due - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+        if source & TRUNCATED:
+            # only the start was kept; go past the limit again
+            line += b"~"
+        if server.broadcast(line) == 0:
+            raise ConnectionError("surface disconnected")
+        sent_bytes += len(line) + 2
+    return len(lines), sent_bytes, time.monotonic() - start
+
+
+def cmd_dump(args):
+    frames = read_capture(args.capture)
+    first_ms = frames[0][0] if frames else 0
+    session = 0
+    for ms, source, line in frames:
+        text = line.decode("ascii", "replace")
+        if source == SESSION:
+            session += 1
+            first_ms = ms
+            print("---------- session %d at %u ms: %s" % (session, ms, text))
+            continue
+        print("%10.3f %d%s %s" % (((ms - first_ms) & 0xFFFFFFFF) / 1000.0, link_of(source),
+                                  " (overlong, start only)" if source & TRUNCATED else "", text))
+    return 0
+
+
+def cmd_serve(args):
+    frames = read_capture(args.capture)
+    if args.source is not None:
+        frames = [f for f in frames if f[1] == SESSION or link_of(f[1]) == args.source]
+    print("loaded %d frames, %d sessions"
+          % (len(frames), sum(1 for f in frames if f[1] == SESSION)), file=sys.stderr)
+    server = VmixStandIn(args.bind, args.port)
+    try:
+        print("waiting for surface on port %d..." % args.port, file=sys.stderr)
+        server.wait_for_client()
+        # give the surface time to send all SUBSCRIBE lines
+        time.sleep(0.5)
+        for loop in range(args.loops):
+            lines, sent, secs = replay(server, frames, args.speed)
+            rate = lines / secs if secs > 0 else float("inf")
+            print("loop %d: %d lines, %d bytes in %.3f s (%.0f lines/s)"
+                  % (loop + 1, lines, sent, secs, rate))
+    except (ConnectionError, KeyboardInterrupt) as e:
+        print("stopped: %s" % e, file=sys.stderr)
+        return 1
+    finally:
+        server.close()
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("dump", help="print a capture as text")
+    p.add_argument("capture")
+    p.set_defaults(func=cmd_dump)
+
+    p = sub.add_parser("serve", help="act as vMix and replay a capture")
+    p.add_argument("capture")
+    p.add_argument("--bind", default="0.0.0.0")
+    p.add_argument("--port", type=int, default=VMIX_PORT)
+    p.add_argument("--speed", type=float, default=1.0,
+                   help="replay speed factor, 0 for max speed")
+    p.add_argument("--loops", type=int, default=1)
+    p.add_argument("--source", type=int, default=None,
+                   help="only replay lines from this vMix link (0 primary, 1 secondary)")
+    p.set_defaults(func=cmd_serve)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())